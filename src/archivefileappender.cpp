@@ -0,0 +1,490 @@
+/*
+  SPDX-FileCopyrightText: 2026 KDE PIM Authors
+
+  SPDX-License-Identifier: GPL-2.0-or-later WITH Qt-Commercial-exception-1.0
+*/
+
+#include "archivefileappender.h"
+#include "calendarsupport_debug.h"
+
+#include <KCalendarCore/ICalFormat>
+
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSet>
+
+#include <functional>
+
+using namespace CalendarSupport;
+
+// Bump the version when the layout of the index changes; older indexes are
+// then rebuilt from the archive.
+static const quint32 indexMagic = 0x41524931; // "ARI1"
+static const quint32 indexVersion = 2;
+
+static const quint32 backupMagic = 0x41525442; // "ARTB"
+static const quint32 backupVersion = 1;
+
+// The trailing END:VCALENDAR is searched for in this many bytes at the end
+// of the archive.  The index and the backup also identify the archive by
+// hashes of this many bytes.
+static const qint64 tailSize = 4096;
+
+// Hashes @p length bytes of @p file from @p start on, returns an empty hash
+// if they can't be read.
+static QByteArray hashRange(QFile &file, qint64 start, qint64 length)
+{
+    if (!file.seek(start)) {
+        return {};
+    }
+    const QByteArray data = file.read(length);
+    if (data.size() != length) {
+        return {};
+    }
+    return QCryptographicHash::hash(data, QCryptographicHash::Sha1);
+}
+
+static QByteArray hashTail(QFile &file)
+{
+    const qint64 size = file.size();
+    return hashRange(file, size - qMin(size, tailSize), qMin(size, tailSize));
+}
+
+namespace
+{
+// Reads the content lines of an iCalendar stream, joining folded lines.
+class ContentLineReader
+{
+public:
+    explicit ContentLineReader(QIODevice *device)
+        : mDevice(device)
+        , mNext(device->readLine())
+    {
+    }
+
+    /// Moves to the next content line, returns false at the end of the stream.
+    bool next()
+    {
+        if (mNext.isEmpty()) {
+            return false;
+        }
+        mRaw = mNext;
+        mUnfolded = withoutLineBreak(mNext);
+        mNext = mDevice->readLine();
+        while (mNext.startsWith(' ') || mNext.startsWith('\t')) {
+            mRaw += mNext;
+            mUnfolded += withoutLineBreak(mNext).mid(1);
+            mNext = mDevice->readLine();
+        }
+
+        const qsizetype colon = mUnfolded.indexOf(':');
+        const qsizetype semicolon = mUnfolded.indexOf(';');
+        const qsizetype nameEnd = semicolon >= 0 && (colon < 0 || semicolon < colon) ? semicolon : colon;
+        mName = mUnfolded.left(nameEnd).trimmed().toUpper();
+        mValue = colon >= 0 ? mUnfolded.mid(colon + 1).trimmed() : QByteArray();
+        return true;
+    }
+
+    /// The line as it appears in the stream, including folds and line break.
+    [[nodiscard]] const QByteArray &raw() const
+    {
+        return mRaw;
+    }
+
+    /// The property name, in upper case.
+    [[nodiscard]] const QByteArray &name() const
+    {
+        return mName;
+    }
+
+    [[nodiscard]] const QByteArray &value() const
+    {
+        return mValue;
+    }
+
+private:
+    static QByteArray withoutLineBreak(const QByteArray &line)
+    {
+        qsizetype length = line.size();
+        while (length > 0 && (line.at(length - 1) == '\n' || line.at(length - 1) == '\r')) {
+            --length;
+        }
+        return line.left(length);
+    }
+
+    QIODevice *const mDevice;
+    QByteArray mNext;
+    QByteArray mRaw;
+    QByteArray mUnfolded;
+    QByteArray mName;
+    QByteArray mValue;
+};
+
+bool isIncidence(const QByteArray &component)
+{
+    return component == "VEVENT" || component == "VTODO" || component == "VJOURNAL";
+}
+}
+
+class CalendarSupport::ArchiveFileAppenderPrivate
+{
+public:
+    bool loadIndex();
+    bool scanArchive();
+    void saveIndex();
+    bool saveBackup(QFile &archive, qint64 offset, const QByteArray &tail, const QByteArray &replacement);
+    bool restoreBackup();
+
+    QString mArchiveFile;
+    QString mIndexFile;
+    QString mBackupFile;
+    QString mErrorString;
+    // Writes the new tail to the archive, replaced by the tests
+    std::function<bool(QFile &, const QByteArray &)> mWriteTail = [](QFile &file, const QByteArray &data) {
+        return file.write(data) == data.size();
+    };
+    QSet<QString> mUids;
+    QSet<QString> mTimeZoneIds;
+};
+
+bool ArchiveFileAppenderPrivate::loadIndex()
+{
+    QFile file(mIndexFile);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream stream(&file);
+    quint32 magic = 0;
+    quint32 version = 0;
+    stream >> magic >> version;
+    if (magic != indexMagic || version != indexVersion) {
+        qCDebug(CALENDARSUPPORT_LOG) << "Ignoring archive index with unknown format" << mIndexFile;
+        return false;
+    }
+    stream.setVersion(QDataStream::Qt_6_0);
+
+    qint64 size = 0;
+    qint64 lastModified = 0;
+    QByteArray hash;
+    stream >> size >> lastModified >> hash >> mUids >> mTimeZoneIds;
+
+    // Size and modification time alone miss a rewrite within the resolution
+    // of the file system's time stamps, so the tail is compared as well.
+    QFile archive(mArchiveFile);
+    const bool fresh = stream.status() == QDataStream::Ok && archive.open(QIODevice::ReadOnly) && size == archive.size()
+        && lastModified == QFileInfo(archive).lastModified().toMSecsSinceEpoch() && !hash.isEmpty() && hash == hashTail(archive);
+    if (!fresh) {
+        // Changed behind our back, e.g. by a full merge
+        mUids.clear();
+        mTimeZoneIds.clear();
+        return false;
+    }
+    return true;
+}
+
+bool ArchiveFileAppenderPrivate::scanArchive()
+{
+    mUids.clear();
+    mTimeZoneIds.clear();
+
+    QFile file(mArchiveFile);
+    if (!file.open(QIODevice::ReadOnly)) {
+        mErrorString = file.errorString();
+        return false;
+    }
+
+    ContentLineReader reader(&file);
+    QList<QByteArray> components;
+    while (reader.next()) {
+        if (reader.name() == "BEGIN") {
+            components.append(reader.value().toUpper());
+        } else if (reader.name() == "END") {
+            if (!components.isEmpty()) {
+                components.removeLast();
+            }
+        } else if (components.size() == 2) {
+            if (reader.name() == "UID" && isIncidence(components.last())) {
+                mUids.insert(QString::fromUtf8(reader.value()));
+            } else if (reader.name() == "TZID" && components.last() == "VTIMEZONE") {
+                mTimeZoneIds.insert(QString::fromUtf8(reader.value()));
+            }
+        }
+    }
+    return true;
+}
+
+void ArchiveFileAppenderPrivate::saveIndex()
+{
+    QFile archive(mArchiveFile);
+    const QByteArray hash = archive.open(QIODevice::ReadOnly) ? hashTail(archive) : QByteArray();
+    if (hash.isEmpty()) {
+        qCDebug(CALENDARSUPPORT_LOG) << "Can't read archive for its index" << mArchiveFile << archive.errorString();
+        QFile::remove(mIndexFile);
+        return;
+    }
+
+    QSaveFile file(mIndexFile);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCDebug(CALENDARSUPPORT_LOG) << "Can't write archive index" << mIndexFile << file.errorString();
+        return;
+    }
+
+    QDataStream stream(&file);
+    stream << indexMagic << indexVersion;
+    stream.setVersion(QDataStream::Qt_6_0);
+    stream << archive.size() << QFileInfo(archive).lastModified().toMSecsSinceEpoch() << hash << mUids << mTimeZoneIds;
+    if (!file.commit()) {
+        qCDebug(CALENDARSUPPORT_LOG) << "Can't write archive index" << mIndexFile << file.errorString();
+    }
+}
+
+// Saves the tail of the archive that is about to be replaced.  Besides the
+// old tail, the backup holds a hash of the bytes before it, to tell whether
+// the archive was rewritten since, and a hash of the replacement, to tell
+// whether the replacement was written completely.
+bool ArchiveFileAppenderPrivate::saveBackup(QFile &archive, qint64 offset, const QByteArray &tail, const QByteArray &replacement)
+{
+    const qint64 anchorStart = offset - qMin(offset, tailSize);
+    const QByteArray anchorHash = hashRange(archive, anchorStart, offset - anchorStart);
+    if (anchorHash.isEmpty()) {
+        mErrorString = archive.errorString();
+        return false;
+    }
+
+    QSaveFile file(mBackupFile);
+    if (!file.open(QIODevice::WriteOnly)) {
+        mErrorString = file.errorString();
+        return false;
+    }
+    QDataStream stream(&file);
+    stream << backupMagic << backupVersion;
+    stream.setVersion(QDataStream::Qt_6_0);
+    stream << offset << anchorHash << tail << qint64(replacement.size()) << QCryptographicHash::hash(replacement, QCryptographicHash::Sha1);
+    if (!file.commit()) {
+        mErrorString = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+// Puts back the tail saved by an append that did not finish.
+bool ArchiveFileAppenderPrivate::restoreBackup()
+{
+    QFile backup(mBackupFile);
+    if (!backup.exists()) {
+        return true;
+    }
+    if (!backup.open(QIODevice::ReadOnly)) {
+        mErrorString = backup.errorString();
+        return false;
+    }
+
+    QDataStream stream(&backup);
+    quint32 magic = 0;
+    quint32 version = 0;
+    stream >> magic >> version;
+    stream.setVersion(QDataStream::Qt_6_0);
+    qint64 offset = 0;
+    QByteArray anchorHash;
+    QByteArray tail;
+    qint64 replacementSize = 0;
+    QByteArray replacementHash;
+    stream >> offset >> anchorHash >> tail >> replacementSize >> replacementHash;
+    backup.close();
+
+    QFile archive(mArchiveFile);
+    if (!archive.open(QIODevice::ReadWrite)) {
+        mErrorString = archive.errorString();
+        return false;
+    }
+
+    // Every index is in doubt after an interrupted append
+    QFile::remove(mIndexFile);
+
+    const qint64 size = archive.size();
+    const qint64 anchorStart = offset - qMin(offset, tailSize);
+    if (magic != backupMagic || version != backupVersion || stream.status() != QDataStream::Ok || size < offset
+        || size > offset + qMax(qint64(tail.size()), replacementSize) || hashRange(archive, anchorStart, offset - anchorStart) != anchorHash) {
+        qCDebug(CALENDARSUPPORT_LOG) << "Ignoring archive backup that does not match the archive" << mBackupFile;
+        backup.remove();
+        return true;
+    }
+
+    archive.seek(offset);
+    const QByteArray written = archive.readAll();
+    if (written != tail
+        && (written.size() != replacementSize || QCryptographicHash::hash(written, QCryptographicHash::Sha1) != replacementHash)) {
+        qCDebug(CALENDARSUPPORT_LOG) << "Restoring the tail of an interrupted append to" << mArchiveFile;
+        if (!archive.seek(offset) || archive.write(tail) != tail.size() || !archive.resize(offset + tail.size()) || !archive.flush()) {
+            mErrorString = archive.errorString();
+            return false;
+        }
+    }
+    archive.close();
+    backup.remove();
+    return true;
+}
+
+ArchiveFileAppender::ArchiveFileAppender(const QString &archiveFile)
+    : d(new ArchiveFileAppenderPrivate)
+{
+    d->mArchiveFile = archiveFile;
+    d->mIndexFile = archiveFile + QLatin1String(".index");
+    d->mBackupFile = archiveFile + QLatin1String(".tail");
+}
+
+ArchiveFileAppender::~ArchiveFileAppender() = default;
+
+QString ArchiveFileAppender::archiveFile() const
+{
+    return d->mArchiveFile;
+}
+
+QString ArchiveFileAppender::indexFile() const
+{
+    return d->mIndexFile;
+}
+
+QString ArchiveFileAppender::backupFile() const
+{
+    return d->mBackupFile;
+}
+
+QString ArchiveFileAppender::errorString() const
+{
+    return d->mErrorString;
+}
+
+ArchiveFileAppender::Result ArchiveFileAppender::append(const KCalendarCore::Calendar::Ptr &calendar)
+{
+    d->mErrorString.clear();
+
+    const QFileInfo archive(d->mArchiveFile);
+    if (!archive.exists() || archive.size() == 0) {
+        return NeedsMerge;
+    }
+    if (!d->restoreBackup()) {
+        return Failed;
+    }
+    if (!d->loadIndex() && !d->scanArchive()) {
+        return Failed;
+    }
+
+    // Take the top level components out of the serialized calendar, leaving
+    // out time zones the archive already defines.
+    KCalendarCore::ICalFormat format;
+    QByteArray text = format.toString(calendar).toUtf8();
+    QBuffer buffer(&text);
+    buffer.open(QIODevice::ReadOnly);
+
+    QByteArray components;
+    QSet<QString> uids;
+    QSet<QString> timeZoneIds;
+    QByteArray block;
+    QString blockUid;
+    QString blockTimeZoneId;
+    QList<QByteArray> nesting;
+    ContentLineReader reader(&buffer);
+    while (reader.next()) {
+        if (reader.name() == "BEGIN") {
+            nesting.append(reader.value().toUpper());
+            if (nesting.size() == 2) {
+                block.clear();
+                blockUid.clear();
+                blockTimeZoneId.clear();
+            }
+        }
+        if (nesting.size() < 2) {
+            continue;
+        }
+        block += reader.raw();
+
+        if (nesting.size() == 2 && reader.name() == "UID") {
+            blockUid = QString::fromUtf8(reader.value());
+        } else if (nesting.size() == 2 && reader.name() == "TZID") {
+            blockTimeZoneId = QString::fromUtf8(reader.value());
+        } else if (reader.name() == "END") {
+            if (nesting.size() == 2) {
+                const QByteArray &component = nesting.last();
+                if (component == "VTIMEZONE") {
+                    if (!d->mTimeZoneIds.contains(blockTimeZoneId) && !timeZoneIds.contains(blockTimeZoneId)) {
+                        timeZoneIds.insert(blockTimeZoneId);
+                        components += block;
+                    }
+                } else {
+                    if (isIncidence(component)) {
+                        if (d->mUids.contains(blockUid)) {
+                            return NeedsMerge;
+                        }
+                        uids.insert(blockUid);
+                    }
+                    components += block;
+                }
+            }
+            nesting.removeLast();
+        }
+    }
+    if (components.isEmpty()) {
+        return Appended;
+    }
+
+    QFile file(d->mArchiveFile);
+    if (!file.open(QIODevice::ReadWrite)) {
+        d->mErrorString = file.errorString();
+        return Failed;
+    }
+
+    // Only the trailing END:VCALENDAR is replaced
+    const qint64 size = file.size();
+    const qint64 tailStart = size - qMin(size, tailSize);
+    if (!file.seek(tailStart)) {
+        d->mErrorString = file.errorString();
+        return Failed;
+    }
+    const QByteArray tail = file.read(size - tailStart);
+    const qsizetype end = tail.toUpper().lastIndexOf("END:VCALENDAR");
+    if (end < 0 || (end > 0 && tail.at(end - 1) != '\n') || !tail.mid(end + qstrlen("END:VCALENDAR")).trimmed().isEmpty()) {
+        qCDebug(CALENDARSUPPORT_LOG) << "No trailing END:VCALENDAR in archive" << d->mArchiveFile;
+        return NeedsMerge;
+    }
+
+    components += "END:VCALENDAR\r\n";
+    const QByteArray replaced = tail.mid(end);
+    if (!d->saveBackup(file, tailStart + end, replaced, components)) {
+        return Failed;
+    }
+
+    if (!file.seek(tailStart + end) || !d->mWriteTail(file, components) || !file.resize(file.pos()) || !file.flush()) {
+        d->mErrorString = file.errorString();
+        // Put the old tail back so that the archive stays readable; if that
+        // fails too, the backup is restored by the next append
+        if (file.seek(tailStart + end) && file.write(replaced) == replaced.size() && file.resize(size) && file.flush()) {
+            QFile::remove(d->mBackupFile);
+        }
+        return Failed;
+    }
+    file.close();
+    QFile::remove(d->mBackupFile);
+
+    d->mUids.unite(uids);
+    d->mTimeZoneIds.unite(timeZoneIds);
+    d->saveIndex();
+    return Appended;
+}
+
+void ArchiveFileAppender::simulateCrashAfter(qint64 bytes)
+{
+    // Closing the archive keeps append() from putting the old tail back, as
+    // a crash would.
+    d->mWriteTail = [bytes](QFile &file, const QByteArray &data) {
+        file.write(data.left(bytes));
+        file.close();
+        return false;
+    };
+}
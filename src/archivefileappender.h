@@ -0,0 +1,95 @@
+/*
+  SPDX-FileCopyrightText: 2026 KDE PIM Authors
+
+  SPDX-License-Identifier: GPL-2.0-or-later WITH Qt-Commercial-exception-1.0
+*/
+
+#pragma once
+
+#include "calendarsupport_private_export.h"
+
+#include <KCalendarCore/Calendar>
+
+#include <QString>
+
+#include <memory>
+
+class ArchiveFileAppenderTest;
+
+namespace CalendarSupport
+{
+class ArchiveFileAppenderPrivate;
+
+/**
+  Appends incidences to an existing local iCalendar archive file without
+  loading the archive.
+
+  The new components are written in place of the trailing END:VCALENDAR,
+  so only the tail of the file is rewritten.  A sidecar index next to the
+  archive remembers the UIDs and time zone ids it contains; it is rebuilt
+  by scanning the archive whenever its size, modification time or the hash
+  of its tail differ from what the index remembers.
+  Time zones already defined by the archive are not written again.
+
+  Writing in place is not atomic: a crash or a full disk in the middle of
+  append() can leave the archive with a damaged tail.  Therefore the old
+  tail is first saved to a backup file next to the archive, which is removed
+  once the archive was written.  A backup left behind by an interrupted
+  append is restored by the next append() to the same archive, unless the
+  archive was rewritten in the meantime.
+
+  This class is internal to the library.
+*/
+class CALENDARSUPPORT_TESTS_EXPORT ArchiveFileAppender
+{
+public:
+    enum Result {
+        Appended, ///< The incidences were appended to the archive.
+        NeedsMerge, ///< The archive cannot be appended to, e.g. because it already holds one of the UIDs; load and merge it instead.
+        Failed, ///< Reading or writing the archive failed, see errorString().
+    };
+
+    explicit ArchiveFileAppender(const QString &archiveFile);
+    ~ArchiveFileAppender();
+
+    /**
+      Returns the archive file appended to.
+    */
+    [[nodiscard]] QString archiveFile() const;
+
+    /**
+      Returns the sidecar index of the archive file.
+    */
+    [[nodiscard]] QString indexFile() const;
+
+    /**
+      Returns the file the tail of the archive is saved to while appending.
+    */
+    [[nodiscard]] QString backupFile() const;
+
+    /**
+      Appends all incidences of @p calendar to the archive.
+
+      The tail left behind by an interrupted append is restored first, even if
+      NeedsMerge or Failed is returned afterwards.  If writing the new
+      components fails, the old tail is put back, so the archive only keeps
+      its previous incidences; should that fail too, the backup is restored
+      by the next append().
+    */
+    [[nodiscard]] Result append(const KCalendarCore::Calendar::Ptr &calendar);
+
+    /**
+      Returns a description of the last failure.
+    */
+    [[nodiscard]] QString errorString() const;
+
+private:
+    friend class ::ArchiveFileAppenderTest;
+
+    // Makes append() stop after writing @p bytes of the new tail,
+    // as if the application crashed.
+    void simulateCrashAfter(qint64 bytes);
+
+    std::unique_ptr<ArchiveFileAppenderPrivate> const d;
+};
+}
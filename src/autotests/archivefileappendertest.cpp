@@ -0,0 +1,224 @@
+/*
+ * SPDX-FileCopyrightText: 2026 KDE PIM Authors
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QTimeZone>
+
+#include "archivefileappender.h"
+
+#include <KCalendarCore/Event>
+#include <KCalendarCore/ICalFormat>
+#include <KCalendarCore/MemoryCalendar>
+
+#include <memory>
+
+class ArchiveFileAppenderTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void init();
+    void appendsIncidences();
+    void writesTimeZonesOnce();
+    void uidCollisionNeedsMerge();
+    void rebuildsStaleIndex();
+    void missingEndNeedsMerge();
+    void rebuildsIndexOfSameSizeArchive();
+    void restoresInterruptedAppend();
+    void ignoresBackupOfRewrittenArchive();
+
+private:
+    QString archiveFile() const;
+
+    std::unique_ptr<QTemporaryDir> mDir;
+};
+
+using namespace CalendarSupport;
+
+static KCalendarCore::MemoryCalendar::Ptr calendarWith(const QStringList &uids, const QTimeZone &timeZone = QTimeZone::utc())
+{
+    KCalendarCore::MemoryCalendar::Ptr calendar(new KCalendarCore::MemoryCalendar(timeZone));
+    int hour = 8;
+    for (const QString &uid : uids) {
+        KCalendarCore::Event::Ptr event(new KCalendarCore::Event);
+        event->setUid(uid);
+        event->setSummary(uid);
+        event->setDtStart(QDateTime(QDate(2010, 7, 24), QTime(hour, 0), timeZone));
+        event->setDtEnd(QDateTime(QDate(2010, 7, 24), QTime(hour + 1, 0), timeZone));
+        calendar->addEvent(event);
+        ++hour;
+    }
+    return calendar;
+}
+
+static QStringList archivedUids(const QString &fileName)
+{
+    KCalendarCore::MemoryCalendar::Ptr calendar(new KCalendarCore::MemoryCalendar(QTimeZone::utc()));
+    KCalendarCore::ICalFormat format;
+    if (!format.load(calendar, fileName)) {
+        return {};
+    }
+    QStringList uids;
+    const KCalendarCore::Incidence::List incidences = calendar->rawIncidences();
+    for (const KCalendarCore::Incidence::Ptr &incidence : incidences) {
+        uids.append(incidence->uid());
+    }
+    uids.sort();
+    return uids;
+}
+
+static QByteArray contents(const QString &fileName)
+{
+    QFile file(fileName);
+    return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+}
+
+void ArchiveFileAppenderTest::init()
+{
+    mDir = std::make_unique<QTemporaryDir>();
+    QVERIFY(mDir->isValid());
+}
+
+QString ArchiveFileAppenderTest::archiveFile() const
+{
+    return mDir->filePath(QStringLiteral("archive.ics"));
+}
+
+void ArchiveFileAppenderTest::appendsIncidences()
+{
+    KCalendarCore::ICalFormat format;
+    QVERIFY(format.save(calendarWith({QStringLiteral("a")}), archiveFile()));
+
+    ArchiveFileAppender appender(archiveFile());
+    QCOMPARE(appender.append(calendarWith({QStringLiteral("b"), QStringLiteral("c")})), ArchiveFileAppender::Appended);
+    QCOMPARE(archivedUids(archiveFile()), QStringList({QStringLiteral("a"), QStringLiteral("b"), QStringLiteral("c")}));
+    QVERIFY(QFile::exists(appender.indexFile()));
+    QVERIFY(!QFile::exists(appender.backupFile()));
+    QVERIFY(contents(archiveFile()).trimmed().endsWith("END:VCALENDAR"));
+
+    // The index written by the first append is used by the next one
+    ArchiveFileAppender next(archiveFile());
+    QCOMPARE(next.append(calendarWith({QStringLiteral("d")})), ArchiveFileAppender::Appended);
+    QCOMPARE(archivedUids(archiveFile()), QStringList({QStringLiteral("a"), QStringLiteral("b"), QStringLiteral("c"), QStringLiteral("d")}));
+}
+
+void ArchiveFileAppenderTest::writesTimeZonesOnce()
+{
+    const QTimeZone berlin("Europe/Berlin");
+    QVERIFY(berlin.isValid());
+
+    KCalendarCore::ICalFormat format;
+    QVERIFY(format.save(calendarWith({QStringLiteral("a")}, berlin), archiveFile()));
+    QCOMPARE(contents(archiveFile()).count("BEGIN:VTIMEZONE"), 1);
+
+    ArchiveFileAppender appender(archiveFile());
+    QCOMPARE(appender.append(calendarWith({QStringLiteral("b")}, berlin)), ArchiveFileAppender::Appended);
+    QCOMPARE(contents(archiveFile()).count("BEGIN:VTIMEZONE"), 1);
+    QCOMPARE(archivedUids(archiveFile()), QStringList({QStringLiteral("a"), QStringLiteral("b")}));
+}
+
+void ArchiveFileAppenderTest::uidCollisionNeedsMerge()
+{
+    KCalendarCore::ICalFormat format;
+    QVERIFY(format.save(calendarWith({QStringLiteral("a")}), archiveFile()));
+    const QByteArray before = contents(archiveFile());
+
+    ArchiveFileAppender appender(archiveFile());
+    QCOMPARE(appender.append(calendarWith({QStringLiteral("b"), QStringLiteral("a")})), ArchiveFileAppender::NeedsMerge);
+    QCOMPARE(contents(archiveFile()), before);
+}
+
+void ArchiveFileAppenderTest::rebuildsStaleIndex()
+{
+    KCalendarCore::ICalFormat format;
+    QVERIFY(format.save(calendarWith({QStringLiteral("a")}), archiveFile()));
+
+    ArchiveFileAppender appender(archiveFile());
+    QCOMPARE(appender.append(calendarWith({QStringLiteral("b")})), ArchiveFileAppender::Appended);
+
+    // Rewritten by a full merge, which does not know about the index
+    QVERIFY(format.save(calendarWith({QStringLiteral("a"), QStringLiteral("b"), QStringLiteral("c")}), archiveFile()));
+
+    ArchiveFileAppender next(archiveFile());
+    QCOMPARE(next.append(calendarWith({QStringLiteral("c")})), ArchiveFileAppender::NeedsMerge);
+}
+
+void ArchiveFileAppenderTest::missingEndNeedsMerge()
+{
+    QFile file(archiveFile());
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write("BEGIN:VCALENDAR\r\nVERSION:2.0\r\n");
+    file.close();
+
+    ArchiveFileAppender appender(archiveFile());
+    QCOMPARE(appender.append(calendarWith({QStringLiteral("a")})), ArchiveFileAppender::NeedsMerge);
+}
+
+void ArchiveFileAppenderTest::rebuildsIndexOfSameSizeArchive()
+{
+    KCalendarCore::ICalFormat format;
+    QVERIFY(format.save(calendarWith({QStringLiteral("a")}), archiveFile()));
+
+    ArchiveFileAppender appender(archiveFile());
+    QCOMPARE(appender.append(calendarWith({QStringLiteral("b")})), ArchiveFileAppender::Appended);
+
+    // Same size and modification time, but another UID
+    QFile file(archiveFile());
+    const QDateTime lastModified = QFileInfo(file).lastModified();
+    QByteArray data = contents(archiveFile());
+    QVERIFY(data.contains("UID:b"));
+    data.replace("UID:b", "UID:c");
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    QCOMPARE(file.write(data), data.size());
+    QVERIFY(file.flush());
+    QVERIFY(file.setFileTime(lastModified, QFileDevice::FileModificationTime));
+    file.close();
+
+    ArchiveFileAppender next(archiveFile());
+    QCOMPARE(next.append(calendarWith({QStringLiteral("c")})), ArchiveFileAppender::NeedsMerge);
+}
+
+void ArchiveFileAppenderTest::restoresInterruptedAppend()
+{
+    KCalendarCore::ICalFormat format;
+    QVERIFY(format.save(calendarWith({QStringLiteral("a")}), archiveFile()));
+    const QByteArray before = contents(archiveFile());
+
+    ArchiveFileAppender appender(archiveFile());
+    appender.simulateCrashAfter(20);
+    QCOMPARE(appender.append(calendarWith({QStringLiteral("b")})), ArchiveFileAppender::Failed);
+    QVERIFY(QFile::exists(appender.backupFile()));
+    QVERIFY(contents(archiveFile()) != before);
+
+    ArchiveFileAppender next(archiveFile());
+    QCOMPARE(next.append(calendarWith({QStringLiteral("c")})), ArchiveFileAppender::Appended);
+    QVERIFY(!QFile::exists(next.backupFile()));
+    QCOMPARE(archivedUids(archiveFile()), QStringList({QStringLiteral("a"), QStringLiteral("c")}));
+}
+
+void ArchiveFileAppenderTest::ignoresBackupOfRewrittenArchive()
+{
+    KCalendarCore::ICalFormat format;
+    QVERIFY(format.save(calendarWith({QStringLiteral("a")}), archiveFile()));
+
+    ArchiveFileAppender appender(archiveFile());
+    appender.simulateCrashAfter(20);
+    QCOMPARE(appender.append(calendarWith({QStringLiteral("b")})), ArchiveFileAppender::Failed);
+
+    // Rewritten by a full merge before the backup was restored
+    QVERIFY(format.save(calendarWith({QStringLiteral("x"), QStringLiteral("b")}), archiveFile()));
+    const QByteArray merged = contents(archiveFile());
+
+    ArchiveFileAppender next(archiveFile());
+    QCOMPARE(next.append(calendarWith({QStringLiteral("b")})), ArchiveFileAppender::NeedsMerge);
+    QVERIFY(!QFile::exists(next.backupFile()));
+    QCOMPARE(contents(archiveFile()), merged);
+}
+
+QTEST_GUILESS_MAIN(ArchiveFileAppenderTest)
+
+#include "archivefileappendertest.moc"
@@ -0,0 +1,202 @@
+/*
+ * SPDX-FileCopyrightText: 2026 KDE PIM Authors
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <QList>
+#include <QRandomGenerator>
+#include <QSet>
+#include <QTest>
+
+#include "cellitem.h"
+#include "cellitemlayout.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+class CellItemLayoutTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void insertReportsOverlappingItems();
+    void removeSplitsCluster();
+    void moveOnlyTouchesAffectedClusters();
+    void matchesPlaceItems();
+};
+
+using namespace CalendarSupport;
+
+// Instances represent a range of cell indexes from startAt up to but not
+// including endBefore.
+struct TestItem : public CellItem {
+    int startAt, endBefore;
+
+    TestItem(int s, int e)
+        : startAt(s)
+        , endBefore(e)
+    {
+    }
+
+    bool overlaps(CellItem *o) const override
+    {
+        auto other = static_cast<TestItem *>(o);
+        return !(other->endBefore <= startAt || other->startAt >= endBefore);
+    }
+
+    [[nodiscard]] bool hasRange() const override
+    {
+        return true;
+    }
+
+    [[nodiscard]] qint64 rangeStart() const override
+    {
+        return startAt;
+    }
+
+    [[nodiscard]] qint64 rangeEnd() const override
+    {
+        return endBefore;
+    }
+};
+
+static QSet<CellItem *> toSet(const QList<CellItem *> &items)
+{
+    return QSet<CellItem *>(items.cbegin(), items.cend());
+}
+
+void CellItemLayoutTest::insertReportsOverlappingItems()
+{
+    TestItem item1(0, 2);
+    TestItem item2(4, 6);
+    TestItem item3(1, 3);
+    CellItemLayout layout;
+
+    QCOMPARE(toSet(layout.insert(&item1)), QSet<CellItem *>({&item1}));
+    QCOMPARE(toSet(layout.insert(&item2)), QSet<CellItem *>({&item2}));
+    QCOMPARE(toSet(layout.insert(&item3)), QSet<CellItem *>({&item1, &item3}));
+    QCOMPARE(layout.count(), 3);
+    QCOMPARE(item1.subCell(), 0);
+    QCOMPARE(item1.subCells(), 2);
+    QCOMPARE(item3.subCell(), 1);
+    QCOMPARE(item3.subCells(), 2);
+    QCOMPARE(item2.subCell(), 0);
+    QCOMPARE(item2.subCells(), 1);
+}
+
+// |item1||item2|         |item1|
+// |_____||_____|  -->    |_____||item3|
+//        |item3|                |_____|
+//        |_____|
+void CellItemLayoutTest::removeSplitsCluster()
+{
+    TestItem item1(0, 2);
+    TestItem item2(1, 3);
+    TestItem item3(2, 4);
+    CellItemLayout layout;
+    layout.insert(&item1);
+    layout.insert(&item2);
+    layout.insert(&item3);
+    QCOMPARE(item3.subCell(), 0);
+    QCOMPARE(item3.subCells(), 2);
+
+    QCOMPARE(toSet(layout.remove(&item2)), QSet<CellItem *>({&item1, &item3}));
+    QVERIFY(!layout.contains(&item2));
+    QCOMPARE(item1.subCells(), 1);
+    QCOMPARE(item3.subCells(), 1);
+    QVERIFY(layout.remove(&item2).isEmpty());
+}
+
+void CellItemLayoutTest::moveOnlyTouchesAffectedClusters()
+{
+    TestItem item1(0, 2);
+    TestItem item2(1, 3);
+    TestItem item3(10, 12);
+    TestItem item4(20, 22);
+    CellItemLayout layout;
+    layout.insert(&item1);
+    layout.insert(&item2);
+    layout.insert(&item3);
+    layout.insert(&item4);
+
+    item2.startAt = 11;
+    item2.endBefore = 13;
+    QCOMPARE(toSet(layout.move(&item2, 11, 13)), QSet<CellItem *>({&item1, &item3}));
+    QCOMPARE(item1.subCells(), 1);
+    QCOMPARE(item2.subCell(), 1);
+    QCOMPARE(item3.subCells(), 2);
+    QCOMPARE(item4.subCells(), 1);
+
+    // Moving within the cluster without changing the layout reports nothing.
+    item2.startAt = 10;
+    QVERIFY(layout.move(&item2, 10, 13).isEmpty());
+}
+
+// After any sequence of edits the layout has to be the one placeItems() gives
+// for the items sorted by range, in insertion order for equal ranges.
+void CellItemLayoutTest::matchesPlaceItems()
+{
+    QRandomGenerator random(42);
+    std::vector<std::unique_ptr<TestItem>> items;
+    QList<TestItem *> order;
+    CellItemLayout layout;
+
+    const auto randomRange = [&random](TestItem *item) {
+        item->startAt = random.bounded(40);
+        item->endBefore = item->startAt + (random.bounded(4) == 0 ? 0 : random.bounded(8));
+    };
+
+    for (int step = 0; step < 500; ++step) {
+        QHash<CellItem *, std::pair<int, int>> before;
+        for (const auto item : std::as_const(order)) {
+            before.insert(item, {item->subCell(), item->subCells()});
+        }
+
+        QList<CellItem *> changed;
+        const int action = order.isEmpty() ? 0 : random.bounded(3);
+        if (action == 0) {
+            items.push_back(std::make_unique<TestItem>(0, 0));
+            randomRange(items.back().get());
+            order.append(items.back().get());
+            changed = layout.insert(order.last());
+        } else {
+            TestItem *item = order.takeAt(random.bounded(order.size()));
+            if (action == 1) {
+                changed = layout.remove(item);
+            } else {
+                randomRange(item);
+                order.append(item);
+                changed = layout.move(item, item->startAt, item->endBefore);
+            }
+        }
+        QCOMPARE(layout.count(), order.size());
+
+        // The layout places items in the order of their ranges, and of
+        // insertion for equal ranges.
+        std::vector<std::unique_ptr<TestItem>> copies;
+        QList<CellItem *> cells;
+        for (const auto item : std::as_const(order)) {
+            copies.push_back(std::make_unique<TestItem>(item->startAt, item->endBefore));
+            cells.append(copies.back().get());
+        }
+        std::stable_sort(cells.begin(), cells.end(), [](const CellItem *a, const CellItem *b) {
+            return a->rangeStart() < b->rangeStart() || (a->rangeStart() == b->rangeStart() && a->rangeEnd() < b->rangeEnd());
+        });
+        CellItem::placeItems(cells);
+
+        QSet<CellItem *> expectedChanged;
+        for (qsizetype i = 0; i < order.size(); ++i) {
+            TestItem *item = order.at(i);
+            QCOMPARE(item->subCell(), copies.at(i)->subCell());
+            QCOMPARE(item->subCells(), copies.at(i)->subCells());
+            if (!before.contains(item) || before.value(item) != std::pair(item->subCell(), item->subCells())) {
+                expectedChanged.insert(item);
+            }
+        }
+        QCOMPARE(toSet(changed), expectedChanged);
+    }
+}
+
+QTEST_MAIN(CellItemLayoutTest)
+
+#include "cellitemlayouttest.moc"
@@ -0,0 +1,251 @@
+/*
+ * SPDX-FileCopyrightText: 2026 KDE PIM Authors
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QRandomGenerator>
+#include <QTest>
+
+#include "cellitem.h"
+#include "cellitemlayout.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+class PlaceItemBenchmark : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void placeItems_data();
+    void placeItems();
+    void placeItemsUnsorted_data();
+    void placeItemsUnsorted();
+    void placeItemsWithoutRanges_data();
+    void placeItemsWithoutRanges();
+    void layoutInsert_data();
+    void layoutInsert();
+};
+
+using namespace CalendarSupport;
+
+// Covers the minutes from start up to but not including end.
+struct BenchItem : public CellItem {
+    const qint64 start, end;
+    const bool ranged;
+
+    BenchItem(qint64 s, qint64 e, bool r)
+        : start(s)
+        , end(e)
+        , ranged(r)
+    {
+    }
+
+    bool overlaps(CellItem *o) const override
+    {
+        auto other = static_cast<BenchItem *>(o);
+        return !(other->end <= start || other->start >= end);
+    }
+
+    [[nodiscard]] bool hasRange() const override
+    {
+        return ranged;
+    }
+
+    [[nodiscard]] qint64 rangeStart() const override
+    {
+        return start;
+    }
+
+    [[nodiscard]] qint64 rangeEnd() const override
+    {
+        return end;
+    }
+};
+
+enum class Pattern {
+    Sparse, // no item overlaps another
+    Dense, // hour long items at random times of one day
+    Nested, // every item contains the next one
+    Staircase, // every item overlaps the three before it
+};
+Q_DECLARE_METATYPE(Pattern)
+
+using Items = std::vector<std::unique_ptr<BenchItem>>;
+
+static Items generateItems(Pattern pattern, int count, bool ranged)
+{
+    QRandomGenerator random(count);
+    Items items;
+    items.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        qint64 start = 0;
+        qint64 end = 0;
+        switch (pattern) {
+        case Pattern::Sparse:
+            start = i * 60;
+            end = start + 30;
+            break;
+        case Pattern::Dense:
+            start = random.bounded(24 * 60 - 60);
+            end = start + 60;
+            break;
+        case Pattern::Nested:
+            start = i;
+            end = 2 * count - i;
+            break;
+        case Pattern::Staircase:
+            start = i * 15;
+            end = start + 60;
+            break;
+        }
+        items.push_back(std::make_unique<BenchItem>(start, end, ranged));
+    }
+    // Callers hand over items in no particular order.
+    std::shuffle(items.begin(), items.end(), random);
+    return items;
+}
+
+static void addRows(const QList<int> &counts)
+{
+    QTest::addColumn<Pattern>("pattern");
+    QTest::addColumn<int>("count");
+
+    const QList<std::pair<const char *, Pattern>> patterns = {
+        {"sparse", Pattern::Sparse},
+        {"dense", Pattern::Dense},
+        {"nested", Pattern::Nested},
+        {"staircase", Pattern::Staircase},
+    };
+    for (const auto &[name, pattern] : patterns) {
+        for (const int count : counts) {
+            QTest::addRow("%s %d", name, count) << pattern << count;
+        }
+    }
+}
+
+static QList<CellItem *> toCells(const Items &items)
+{
+    QList<CellItem *> cells;
+    cells.reserve(items.size());
+    for (const auto &item : items) {
+        cells.append(item.get());
+    }
+    return cells;
+}
+
+// Measures work with QBENCHMARK, so that its command line options apply.
+// QBENCHMARK reports the cost per iteration; the wall time per item is
+// printed as well, so that runs over different item counts can be compared.
+// It is taken over the whole QBENCHMARK loop of this pass, with one timer;
+// QBENCHMARK may run the test function more than once, so the last line
+// printed for a data tag belongs to the pass that is reported.
+template<typename Work>
+static void measure(int count, Work work)
+{
+    qint64 iterations = 0;
+    QElapsedTimer timer;
+    timer.start();
+    QBENCHMARK {
+        work();
+        ++iterations;
+    }
+    const qint64 elapsed = timer.nsecsElapsed();
+
+    if (iterations > 0) {
+        qInfo("%s: %.1f ns/item", QTest::currentDataTag(), double(elapsed) / iterations / count);
+    }
+}
+
+static void sortByRange(QList<CellItem *> &cells)
+{
+    std::stable_sort(cells.begin(), cells.end(), [](const CellItem *a, const CellItem *b) {
+        return a->rangeStart() < b->rangeStart() || (a->rangeStart() == b->rangeStart() && a->rangeEnd() < b->rangeEnd());
+    });
+}
+
+void PlaceItemBenchmark::placeItems_data()
+{
+    addRows({10, 100, 1000, 10000});
+}
+
+// Sorted items are laid out with the sweep line.
+void PlaceItemBenchmark::placeItems()
+{
+    QFETCH(Pattern, pattern);
+    QFETCH(int, count);
+
+    const Items items = generateItems(pattern, count, true);
+    QList<CellItem *> cells = toCells(items);
+    sortByRange(cells);
+
+    measure(count, [&cells]() {
+        CellItem::placeItems(cells);
+    });
+}
+
+void PlaceItemBenchmark::placeItemsUnsorted_data()
+{
+    // Quadratic in the number of items, so leave out the largest workload.
+    addRows({10, 100, 1000});
+}
+
+// Unsorted items are placed in list order, comparing the stored ranges.
+void PlaceItemBenchmark::placeItemsUnsorted()
+{
+    QFETCH(Pattern, pattern);
+    QFETCH(int, count);
+
+    const Items items = generateItems(pattern, count, true);
+    const QList<CellItem *> cells = toCells(items);
+
+    measure(count, [&cells]() {
+        CellItem::placeItems(cells);
+    });
+}
+
+void PlaceItemBenchmark::placeItemsWithoutRanges_data()
+{
+    // Quadratic in the number of items, so leave out the largest workload.
+    addRows({10, 100, 1000});
+}
+
+void PlaceItemBenchmark::placeItemsWithoutRanges()
+{
+    QFETCH(Pattern, pattern);
+    QFETCH(int, count);
+
+    const Items items = generateItems(pattern, count, false);
+    const QList<CellItem *> cells = toCells(items);
+
+    measure(count, [&cells]() {
+        CellItem::placeItems(cells);
+    });
+}
+
+void PlaceItemBenchmark::layoutInsert_data()
+{
+    // Every insert into a single big cluster lays out all of it again.
+    addRows({10, 100, 1000});
+}
+
+void PlaceItemBenchmark::layoutInsert()
+{
+    QFETCH(Pattern, pattern);
+    QFETCH(int, count);
+
+    const Items items = generateItems(pattern, count, true);
+
+    measure(count, [&items]() {
+        CellItemLayout layout;
+        for (const auto &item : items) {
+            layout.insert(item.get());
+        }
+    });
+}
+
+QTEST_GUILESS_MAIN(PlaceItemBenchmark)
+
+#include "placeitembenchmark.moc"
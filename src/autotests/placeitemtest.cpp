@@ -8,6 +8,8 @@
 
 #include "cellitem.h"
 
+#include <vector>
+
 class PlaceItemTest : public QObject
 {
     Q_OBJECT
@@ -20,6 +22,10 @@ private Q_SLOTS:
     void fillLeftGap();
     void fillCenterGap();
     void transitiveOverlap();
+    void placeItemsMatchesPlaceItem_data();
+    void placeItemsMatchesPlaceItem();
+    void placeItemsWithoutRanges_data();
+    void placeItemsWithoutRanges();
 };
 
 using namespace CalendarSupport;
@@ -52,6 +58,21 @@ struct TestItem : public CellItem {
         return !(other->endBefore <= startAt || other->startAt >= endBefore);
     }
 
+    [[nodiscard]] bool hasRange() const override
+    {
+        return true;
+    }
+
+    [[nodiscard]] qint64 rangeStart() const override
+    {
+        return startAt;
+    }
+
+    [[nodiscard]] qint64 rangeEnd() const override
+    {
+        return endBefore;
+    }
+
     [[nodiscard]] QString label() const override
     {
         return name;
@@ -174,6 +195,96 @@ void PlaceItemTest::transitiveOverlap()
     QCOMPARE(item3->subCells(), 3);
 }
 
+// Item that leaves placeItems() nothing but overlaps() to work with.
+struct UnrangedTestItem : public TestItem {
+    using TestItem::TestItem;
+
+    [[nodiscard]] bool hasRange() const override
+    {
+        return false;
+    }
+};
+
+using Ranges = QList<std::pair<int, int>>;
+
+void PlaceItemTest::placeItemsMatchesPlaceItem_data()
+{
+    QTest::addColumn<Ranges>("ranges");
+
+    QTest::newRow("empty") << Ranges{};
+    QTest::newRow("disjoint") << Ranges{{4, 6}, {0, 2}, {2, 4}};
+    QTest::newRow("same range") << Ranges{{1, 3}, {1, 3}, {1, 3}};
+    QTest::newRow("staircase") << Ranges{{3, 6}, {0, 3}, {1, 4}, {2, 5}, {4, 7}};
+    QTest::newRow("nested") << Ranges{{2, 3}, {0, 6}, {1, 5}, {4, 5}};
+    QTest::newRow("transitive") << Ranges{{0, 2}, {2, 4}, {1, 3}, {2, 4}, {5, 6}};
+    QTest::newRow("empty items") << Ranges{{2, 2}, {0, 4}, {2, 5}, {4, 4}, {1, 1}};
+    QTest::newRow("sorted staircase") << Ranges{{0, 3}, {1, 4}, {2, 5}, {3, 6}, {4, 7}};
+    QTest::newRow("sorted nested") << Ranges{{0, 6}, {1, 5}, {2, 3}, {4, 5}};
+    QTest::newRow("sorted transitive") << Ranges{{0, 2}, {1, 3}, {2, 4}, {2, 4}, {5, 6}};
+    QTest::newRow("sorted empty items") << Ranges{{0, 4}, {1, 1}, {2, 2}, {2, 5}, {4, 4}};
+}
+
+// placeItems() has to give the same result as placing the items one by one,
+// in list order, whether or not the sweep line can be used.
+void PlaceItemTest::placeItemsMatchesPlaceItem()
+{
+    QFETCH(Ranges, ranges);
+
+    std::vector<std::unique_ptr<TestItem>> batchItems;
+    std::vector<std::unique_ptr<TestItem>> singleItems;
+    QList<CellItem *> batchCells;
+    QList<CellItem *> singleCells;
+    for (const auto &range : std::as_const(ranges)) {
+        batchItems.push_back(std::make_unique<TestItem>("item", range.first, range.second));
+        batchCells.append(batchItems.back().get());
+        singleItems.push_back(std::make_unique<TestItem>("item", range.first, range.second));
+        singleCells.append(singleItems.back().get());
+    }
+
+    CellItem::placeItems(batchCells);
+    for (const auto cell : std::as_const(singleCells)) {
+        (void)CellItem::placeItem(singleCells, cell);
+    }
+
+    for (qsizetype i = 0; i < batchCells.size(); ++i) {
+        QCOMPARE(batchCells.at(i)->subCell(), singleCells.at(i)->subCell());
+        QCOMPARE(batchCells.at(i)->subCells(), singleCells.at(i)->subCells());
+    }
+}
+
+void PlaceItemTest::placeItemsWithoutRanges_data()
+{
+    placeItemsMatchesPlaceItem_data();
+}
+
+// Without ranges, placeItems() has to give the same result as placing the
+// items one by one in list order.
+void PlaceItemTest::placeItemsWithoutRanges()
+{
+    QFETCH(Ranges, ranges);
+
+    std::vector<std::unique_ptr<UnrangedTestItem>> batchItems;
+    std::vector<std::unique_ptr<UnrangedTestItem>> singleItems;
+    QList<CellItem *> batchCells;
+    QList<CellItem *> singleCells;
+    for (const auto &range : std::as_const(ranges)) {
+        batchItems.push_back(std::make_unique<UnrangedTestItem>("item", range.first, range.second));
+        batchCells.append(batchItems.back().get());
+        singleItems.push_back(std::make_unique<UnrangedTestItem>("item", range.first, range.second));
+        singleCells.append(singleItems.back().get());
+    }
+
+    CellItem::placeItems(batchCells);
+    for (const auto cell : std::as_const(singleCells)) {
+        (void)CellItem::placeItem(singleCells, cell);
+    }
+
+    for (qsizetype i = 0; i < batchCells.size(); ++i) {
+        QCOMPARE(batchCells.at(i)->subCell(), singleCells.at(i)->subCell());
+        QCOMPARE(batchCells.at(i)->subCells(), singleCells.at(i)->subCells());
+    }
+}
+
 QTEST_MAIN(PlaceItemTest)
 
 #include "placeitemtest.moc"
@@ -0,0 +1,16 @@
+/*
+  SPDX-FileCopyrightText: 2026 KDE PIM Authors
+
+  SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "calendarsupport_export.h"
+
+// Exports classes that are internal to the library but used by its tests
+#ifdef BUILD_TESTING
+#define CALENDARSUPPORT_TESTS_EXPORT CALENDARSUPPORT_EXPORT
+#else
+#define CALENDARSUPPORT_TESTS_EXPORT
+#endif
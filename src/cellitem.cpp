@@ -7,6 +7,13 @@
 #include <QSet>
 
 #include "cellitem.h"
+#include "cellitemintervals.h"
+
+#include <algorithm>
+#include <functional>
+#include <numeric>
+#include <queue>
+#include <vector>
 
 #include "calendarsupport_debug.h"
 #include <KLocalizedString>
@@ -33,11 +40,54 @@ int CellItem::subCell() const
     return mSubCell;
 }
 
+bool CellItem::hasRange() const
+{
+    return false;
+}
+
+qint64 CellItem::rangeStart() const
+{
+    return 0;
+}
+
+qint64 CellItem::rangeEnd() const
+{
+    return 0;
+}
+
 QString CellItem::label() const
 {
     return xi18n("<placeholder>undefined</placeholder>");
 }
 
+// Gives placeItem the lowest subcell not used by the items it overlaps
+// directly.  If all are used, all overlapping items have to squeeze over.
+static void placeInCluster(CellItem *placeItem, QList<CellItem *> &overlappingItems, const QSet<int> &subCellsInUse, int maxSubCells)
+{
+    if (overlappingItems.count() > 1) {
+        int i;
+        for (i = 0; i < maxSubCells; ++i) {
+            if (!subCellsInUse.contains(i)) {
+                break;
+            }
+        }
+        placeItem->setSubCell(i);
+        if (i == maxSubCells) {
+            maxSubCells += 1;
+            for (auto item : std::as_const(overlappingItems)) {
+                item->setSubCells(maxSubCells);
+            }
+        }
+        placeItem->setSubCells(maxSubCells);
+        qCDebug(CALENDARSUPPORT_LOG) << "use subcell" << i << "of" << maxSubCells;
+    } else {
+        // Nothing overlapped placeItem, so:
+        overlappingItems.clear();
+        placeItem->setSubCell(0);
+        placeItem->setSubCells(1);
+    }
+}
+
 QList<CellItem *> CellItem::placeItem(const QList<CellItem *> &cells, CellItem *placeItem)
 {
     int maxSubCells = 0;
@@ -45,12 +95,14 @@ QList<CellItem *> CellItem::placeItem(const QList<CellItem *> &cells, CellItem *
 
     // Find all items that overlap placeItem, the items that overlaps them, and so on.
     QList<CellItem *> overlappingItems{placeItem};
+    QSet<CellItem *> foundItems{placeItem};
     for (int i = 0; i < overlappingItems.count(); i++) {
         const auto checkItem = overlappingItems.at(i);
         for (const auto item : cells) {
-            if (item->overlaps(checkItem) && !overlappingItems.contains(item)) {
+            if (!foundItems.contains(item) && item->overlaps(checkItem)) {
                 qCDebug(CALENDARSUPPORT_LOG) << item->label() << "overlaps" << checkItem->label();
                 overlappingItems.append(item);
+                foundItems.insert(item);
                 if (item->subCell() >= maxSubCells) {
                     maxSubCells = item->subCells();
                 }
@@ -61,30 +113,170 @@ QList<CellItem *> CellItem::placeItem(const QList<CellItem *> &cells, CellItem *
         }
     }
 
-    if (overlappingItems.count() > 1) {
-        // Look for an unused subcell in placeItem's cells.  If all are used,
-        // all overlapping items have to squeeze over.
-        int i;
-        for (i = 0; i < maxSubCells; ++i) {
-            if (!subCellsInUse.contains(i)) {
-                break;
-            }
+    placeInCluster(placeItem, overlappingItems, subCellsInUse, maxSubCells);
+    return overlappingItems;
+}
+
+namespace
+{
+// Disjoint sets of item indexes, each set remembering the highest subcell
+// used by its items.
+class SubCellClusters
+{
+public:
+    explicit SubCellClusters(qsizetype count)
+        : mParents(count)
+        , mMaxSubCells(count, 0)
+    {
+        std::iota(mParents.begin(), mParents.end(), 0);
+    }
+
+    qsizetype find(qsizetype index)
+    {
+        while (mParents[index] != index) {
+            mParents[index] = mParents[mParents[index]];
+            index = mParents[index];
         }
-        placeItem->setSubCell(i);
-        if (i == maxSubCells) {
-            maxSubCells += 1;
-            for (auto item : overlappingItems) {
-                item->setSubCells(maxSubCells);
+        return index;
+    }
+
+    void unite(qsizetype a, qsizetype b)
+    {
+        a = find(a);
+        b = find(b);
+        if (a != b) {
+            mParents[b] = a;
+            mMaxSubCells[a] = std::max(mMaxSubCells[a], mMaxSubCells[b]);
+        }
+    }
+
+    void useSubCell(qsizetype index, int subCell)
+    {
+        const qsizetype root = find(index);
+        mMaxSubCells[root] = std::max(mMaxSubCells[root], subCell);
+    }
+
+    int maxSubCell(qsizetype index)
+    {
+        return mMaxSubCells[find(index)];
+    }
+
+private:
+    std::vector<qsizetype> mParents;
+    std::vector<int> mMaxSubCells;
+};
+}
+
+// Gives the same result as calling placeItem() for each item of cells in
+// turn: every item gets the lowest subcell not used by the items placed
+// before it that it overlaps, and all items of a cluster end up with the
+// number of subcells the cluster uses.  The clusters are kept in disjoint
+// sets instead of being searched for every item, and the number of subcells
+// is set once per item at the end.  findEarlierOverlapping(i, indexes) has to
+// append the indexes of the items before i overlapping item i.
+template<typename FindEarlierOverlapping>
+static void placeItemsInListOrder(const QList<CellItem *> &cells, FindEarlierOverlapping findEarlierOverlapping)
+{
+    SubCellClusters clusters(cells.size());
+    QSet<int> subCellsInUse;
+    QList<qsizetype> overlapping;
+    for (qsizetype i = 0; i < cells.size(); ++i) {
+        CellItem *placeItem = cells.at(i);
+        subCellsInUse.clear();
+        overlapping.clear();
+        findEarlierOverlapping(i, overlapping);
+        for (const qsizetype j : std::as_const(overlapping)) {
+            subCellsInUse.insert(cells.at(j)->subCell());
+            clusters.unite(i, j);
+        }
+
+        int subCell = 0;
+        while (subCellsInUse.contains(subCell)) {
+            ++subCell;
+        }
+        placeItem->setSubCell(subCell);
+        clusters.useSubCell(i, subCell);
+    }
+
+    for (qsizetype i = 0; i < cells.size(); ++i) {
+        cells.at(i)->setSubCells(clusters.maxSubCell(i) + 1);
+    }
+}
+
+void CellItem::placeItems(const QList<CellItem *> &cells)
+{
+    for (auto item : std::as_const(cells)) {
+        item->setSubCell(-1);
+        item->setSubCells(0);
+    }
+
+    const bool haveRanges = std::all_of(cells.cbegin(), cells.cend(), [](const CellItem *item) {
+        return item->hasRange();
+    });
+    if (!haveRanges) {
+        placeItemsInListOrder(cells, [&cells](qsizetype i, QList<qsizetype> &overlapping) {
+            for (qsizetype j = 0; j < i; ++j) {
+                if (cells.at(j)->overlaps(cells.at(i))) {
+                    overlapping.append(j);
+                }
             }
+        });
+        return;
+    }
+
+    // The sweep places items in the order of their ranges, which is only the
+    // list order if the list is sorted.  Empty items have to come before
+    // longer ones starting at the same position, so that they never share the
+    // sweep position with an item they don't overlap.
+    const CellItemIntervals intervals(cells);
+    for (qsizetype i = 1; i < intervals.size(); ++i) {
+        if (intervals.start(i) < intervals.start(i - 1) || (intervals.start(i) == intervals.start(i - 1) && intervals.end(i) < intervals.end(i - 1))) {
+            placeItemsInListOrder(cells, [&intervals](qsizetype i, QList<qsizetype> &overlapping) {
+                intervals.findOverlapping(intervals.start(i), intervals.end(i), overlapping, i);
+            });
+            return;
         }
-        placeItem->setSubCells(maxSubCells);
-        qCDebug(CALENDARSUPPORT_LOG) << "use subcell" << i << "of" << maxSubCells;
-    } else {
-        // Nothing overlapped placeItem, so:
-        overlappingItems.clear();
-        placeItem->setSubCell(0);
-        placeItem->setSubCells(1);
     }
 
-    return overlappingItems;
+    // Items that are still running at the sweep position keep their subcell,
+    // the lowest released subcell goes to the next item.  When nothing is
+    // running any more, the transitively overlapping cluster is complete and
+    // all its items share the number of subcells it used.
+    using RunningItem = std::pair<qint64, int>; // end of range, subcell
+    std::priority_queue<RunningItem, std::vector<RunningItem>, std::greater<>> runningItems;
+    std::priority_queue<int, std::vector<int>, std::greater<>> freeSubCells;
+    qsizetype clusterStart = 0;
+    int clusterSubCells = 0;
+
+    const auto finishCluster = [&](qsizetype clusterEnd) {
+        for (qsizetype i = clusterStart; i < clusterEnd; ++i) {
+            intervals.item(i)->setSubCells(clusterSubCells);
+        }
+    };
+
+    for (qsizetype i = 0; i < intervals.size(); ++i) {
+        const qint64 start = intervals.start(i);
+        while (!runningItems.empty() && runningItems.top().first <= start) {
+            freeSubCells.push(runningItems.top().second);
+            runningItems.pop();
+        }
+
+        if (runningItems.empty()) {
+            finishCluster(i);
+            clusterStart = i;
+            clusterSubCells = 0;
+            freeSubCells = {};
+        }
+
+        int subCell;
+        if (freeSubCells.empty()) {
+            subCell = clusterSubCells++;
+        } else {
+            subCell = freeSubCells.top();
+            freeSubCells.pop();
+        }
+        intervals.item(i)->setSubCell(subCell);
+        runningItems.emplace(intervals.end(i), subCell);
+    }
+    finishCluster(intervals.size());
 }
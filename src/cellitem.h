@@ -28,6 +28,26 @@ public:
 
     [[nodiscard]] virtual QString label() const;
 
+    /**
+      Returns true if the item covers the range [rangeStart(), rangeEnd()).
+      In that case overlaps() must be equivalent to two such ranges
+      intersecting, which allows placeItems() to use a sweep line instead of
+      testing every pair of items.  The default implementation returns false.
+    */
+    [[nodiscard]] virtual bool hasRange() const;
+
+    /**
+      Returns the first position covered by the item, e.g. milliseconds since
+      the epoch.  Only used if hasRange() returns true.
+    */
+    [[nodiscard]] virtual qint64 rangeStart() const;
+
+    /**
+      Returns the position after the last one covered by the item.  It must
+      not be less than rangeStart().  Only used if hasRange() returns true.
+    */
+    [[nodiscard]] virtual qint64 rangeEnd() const;
+
     /**
       Place item @p placeItem into stripe containing items @p cells in a
       way that items don't overlap.
@@ -38,6 +58,21 @@ public:
     */
     static QList<CellItem *> placeItem(const QList<CellItem *> &cells, CellItem *placeItem);
 
+    /**
+      Place all items in @p cells so that overlapping items don't share a
+      subcell.  The result is identical to calling placeItem() for each item
+      of @p cells in turn, and @p cells is left in its order.
+
+      If all items provide a range and @p cells is sorted by range start, then
+      range end, the items are laid out with a sweep line in O(n log n).
+      Otherwise the clusters of overlapping items are tracked in disjoint sets
+      while the items are placed in list order, comparing the ranges directly
+      instead of calling overlaps() if all items provide one.
+
+      @param cells The items to be laid out.
+    */
+    static void placeItems(const QList<CellItem *> &cells);
+
 private:
     int mSubCells = 0;
     int mSubCell = -1;
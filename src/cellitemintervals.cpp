@@ -0,0 +1,73 @@
+/*
+  SPDX-FileCopyrightText: 2026 KDE PIM Authors
+
+  SPDX-License-Identifier: GPL-2.0-or-later WITH Qt-Commercial-exception-1.0
+*/
+
+#include "cellitemintervals.h"
+#include "cellitem.h"
+
+#include <QtAlgorithms>
+
+#include <algorithm>
+
+using namespace CalendarSupport;
+
+CellItemIntervals::CellItemIntervals(const QList<CellItem *> &items)
+{
+    reserve(items.size());
+    for (const auto item : items) {
+        append(item);
+    }
+}
+
+void CellItemIntervals::append(CellItem *item)
+{
+    Q_ASSERT(item->hasRange());
+    append(item, item->rangeStart(), item->rangeEnd());
+}
+
+void CellItemIntervals::append(CellItem *item, qint64 start, qint64 end)
+{
+    mStarts.append(start);
+    mEnds.append(end);
+    mItems.append(item);
+}
+
+void CellItemIntervals::reserve(qsizetype size)
+{
+    mStarts.reserve(size);
+    mEnds.reserve(size);
+    mItems.reserve(size);
+}
+
+void CellItemIntervals::clear()
+{
+    mStarts.clear();
+    mEnds.clear();
+    mItems.clear();
+}
+
+void CellItemIntervals::findOverlapping(qint64 start, qint64 end, QList<qsizetype> &indexes, qsizetype count) const
+{
+    const qint64 *starts = mStarts.constData();
+    const qint64 *ends = mEnds.constData();
+    if (count < 0 || count > mStarts.size()) {
+        count = mStarts.size();
+    }
+
+    // Collect the results of 64 compares in a mask first; that inner loop has
+    // no branches and can be vectorized by the compiler.
+    for (qsizetype block = 0; block < count; block += 64) {
+        const qsizetype blockSize = std::min<qsizetype>(64, count - block);
+        quint64 mask = 0;
+        for (qsizetype i = 0; i < blockSize; ++i) {
+            const bool overlaps = (starts[block + i] < end) & (ends[block + i] > start);
+            mask |= quint64(overlaps) << i;
+        }
+        while (mask) {
+            indexes.append(block + qCountTrailingZeroBits(mask));
+            mask &= mask - 1;
+        }
+    }
+}
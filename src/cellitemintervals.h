@@ -0,0 +1,84 @@
+/*
+  SPDX-FileCopyrightText: 2026 KDE PIM Authors
+
+  SPDX-License-Identifier: GPL-2.0-or-later WITH Qt-Commercial-exception-1.0
+*/
+
+#pragma once
+
+#include <QList>
+
+namespace CalendarSupport
+{
+class CellItem;
+
+/**
+  The ranges of a list of cell items, stored as flat arrays of start and end
+  positions next to the item pointers.
+
+  Overlap tests against the store are plain integer compares over contiguous
+  memory, instead of a virtual CellItem::overlaps() call per pair of items.
+  All items must provide a range, see CellItem::hasRange().  Used by
+  CellItem::placeItems(); not part of the public API.
+*/
+class CellItemIntervals
+{
+public:
+    CellItemIntervals() = default;
+
+    /**
+      Creates a store holding the ranges of @p items, in the same order.
+    */
+    explicit CellItemIntervals(const QList<CellItem *> &items);
+
+    /**
+      Appends @p item with its current range.
+    */
+    void append(CellItem *item);
+
+    /**
+      Appends @p item covering the range [@p start, @p end).
+    */
+    void append(CellItem *item, qint64 start, qint64 end);
+
+    void reserve(qsizetype size);
+    void clear();
+
+    [[nodiscard]] qsizetype size() const
+    {
+        return mItems.size();
+    }
+
+    [[nodiscard]] CellItem *item(qsizetype index) const
+    {
+        return mItems.at(index);
+    }
+
+    [[nodiscard]] qint64 start(qsizetype index) const
+    {
+        return mStarts.at(index);
+    }
+
+    [[nodiscard]] qint64 end(qsizetype index) const
+    {
+        return mEnds.at(index);
+    }
+
+    [[nodiscard]] const QList<CellItem *> &items() const
+    {
+        return mItems;
+    }
+
+    /**
+      Appends to @p indexes the index of every stored range overlapping
+      [@p start, @p end), in ascending order.  Only the first @p count ranges
+      are searched, all of them if @p count is negative.
+    */
+    void findOverlapping(qint64 start, qint64 end, QList<qsizetype> &indexes, qsizetype count = -1) const;
+
+private:
+    QList<qint64> mStarts;
+    QList<qint64> mEnds;
+    QList<CellItem *> mItems;
+};
+}
@@ -0,0 +1,254 @@
+/*
+  SPDX-FileCopyrightText: 2026 KDE PIM Authors
+
+  SPDX-License-Identifier: GPL-2.0-or-later WITH Qt-Commercial-exception-1.0
+*/
+
+#include "cellitemlayout.h"
+#include "cellitem.h"
+
+#include <QHash>
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <map>
+#include <queue>
+#include <tuple>
+#include <vector>
+
+using namespace CalendarSupport;
+
+namespace
+{
+// Orders entries by start, then end, then insertion order, the order in
+// which CellItem::placeItems() can use its sweep line.
+using EntryKey = std::tuple<qint64, qint64, quint64>;
+
+struct Entry {
+    qint64 start;
+    qint64 end;
+    quint64 serial;
+    CellItem *item;
+
+    [[nodiscard]] EntryKey key() const
+    {
+        return {start, end, serial};
+    }
+};
+
+// A set of transitively overlapping entries.  Clusters never overlap each
+// other, so ordering them by their first entry also orders them by end.
+struct Cluster {
+    qint64 end = 0;
+    std::vector<Entry> entries;
+};
+
+// Remembers the subcells of the items touched by an edit, before the edit.
+class Changes
+{
+public:
+    void record(CellItem *item)
+    {
+        if (!mBefore.contains(item)) {
+            mBefore.insert(item, {item->subCell(), item->subCells()});
+            mItems.append(item);
+        }
+    }
+
+    [[nodiscard]] QList<CellItem *> changedItems() const
+    {
+        QList<CellItem *> changed;
+        for (const auto item : std::as_const(mItems)) {
+            if (mBefore.value(item) != std::pair(item->subCell(), item->subCells())) {
+                changed.append(item);
+            }
+        }
+        return changed;
+    }
+
+private:
+    QHash<CellItem *, std::pair<int, int>> mBefore;
+    QList<CellItem *> mItems;
+};
+}
+
+class CalendarSupport::CellItemLayoutPrivate
+{
+public:
+    void insertEntry(const Entry &entry, Changes &changes);
+    Entry takeEntry(CellItem *item, Changes &changes);
+    void layOut(std::vector<Entry> &entries);
+
+    std::map<EntryKey, Cluster> mClusters;
+    QHash<CellItem *, EntryKey> mClusterOfItem;
+    quint64 mNextSerial = 0;
+};
+
+void CellItemLayoutPrivate::insertEntry(const Entry &entry, Changes &changes)
+{
+    std::vector<Entry> entries{entry};
+    changes.record(entry.item);
+
+    // Clusters starting before the entry ends are candidates; walking back
+    // from the last of them, they overlap the entry until one ends too early.
+    auto it = mClusters.lower_bound(EntryKey{entry.end, std::numeric_limits<qint64>::min(), 0});
+    while (it != mClusters.begin()) {
+        const auto previous = std::prev(it);
+        if (previous->second.end <= entry.start) {
+            break;
+        }
+        for (const Entry &other : previous->second.entries) {
+            changes.record(other.item);
+            entries.push_back(other);
+        }
+        it = mClusters.erase(previous);
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+        return a.key() < b.key();
+    });
+    layOut(entries);
+}
+
+Entry CellItemLayoutPrivate::takeEntry(CellItem *item, Changes &changes)
+{
+    const auto clusterIt = mClusters.find(mClusterOfItem.take(item));
+    Q_ASSERT(clusterIt != mClusters.end());
+    std::vector<Entry> entries = std::move(clusterIt->second.entries);
+    mClusters.erase(clusterIt);
+
+    const auto entryIt = std::find_if(entries.begin(), entries.end(), [item](const Entry &entry) {
+        return entry.item == item;
+    });
+    Q_ASSERT(entryIt != entries.end());
+    const Entry taken = *entryIt;
+    entries.erase(entryIt);
+
+    // Without the entry, the rest of the cluster may fall apart.
+    for (const Entry &entry : entries) {
+        changes.record(entry.item);
+    }
+    layOut(entries);
+    return taken;
+}
+
+// Same sweep as CellItem::placeItems(), but over sorted entries of what used
+// to be one or more clusters, storing the clusters it finds.
+void CellItemLayoutPrivate::layOut(std::vector<Entry> &entries)
+{
+    using RunningItem = std::pair<qint64, int>; // end of range, subcell
+    std::priority_queue<RunningItem, std::vector<RunningItem>, std::greater<>> runningItems;
+    std::priority_queue<int, std::vector<int>, std::greater<>> freeSubCells;
+    std::size_t clusterStart = 0;
+    int clusterSubCells = 0;
+    qint64 clusterEnd = 0;
+
+    const auto finishCluster = [&](std::size_t clusterStop) {
+        if (clusterStop == clusterStart) {
+            return;
+        }
+        const EntryKey key = entries.at(clusterStart).key();
+        Cluster cluster;
+        cluster.end = clusterEnd;
+        cluster.entries.assign(entries.begin() + clusterStart, entries.begin() + clusterStop);
+        for (const Entry &entry : cluster.entries) {
+            entry.item->setSubCells(clusterSubCells);
+            mClusterOfItem.insert(entry.item, key);
+        }
+        mClusters.emplace(key, std::move(cluster));
+    };
+
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+        const Entry &entry = entries.at(i);
+        while (!runningItems.empty() && runningItems.top().first <= entry.start) {
+            freeSubCells.push(runningItems.top().second);
+            runningItems.pop();
+        }
+
+        if (runningItems.empty()) {
+            finishCluster(i);
+            clusterStart = i;
+            clusterSubCells = 0;
+            clusterEnd = entry.end;
+            freeSubCells = {};
+        }
+
+        int subCell;
+        if (freeSubCells.empty()) {
+            subCell = clusterSubCells++;
+        } else {
+            subCell = freeSubCells.top();
+            freeSubCells.pop();
+        }
+        entry.item->setSubCell(subCell);
+        runningItems.emplace(entry.end, subCell);
+        clusterEnd = std::max(clusterEnd, entry.end);
+    }
+    finishCluster(entries.size());
+}
+
+CellItemLayout::CellItemLayout()
+    : d(new CellItemLayoutPrivate)
+{
+}
+
+CellItemLayout::~CellItemLayout() = default;
+
+QList<CellItem *> CellItemLayout::insert(CellItem *item)
+{
+    Q_ASSERT(item->hasRange());
+    if (contains(item)) {
+        return move(item, item->rangeStart(), item->rangeEnd());
+    }
+
+    // Make sure the new item is reported as changed.
+    item->setSubCell(-1);
+    item->setSubCells(0);
+
+    Changes changes;
+    d->insertEntry(Entry{item->rangeStart(), item->rangeEnd(), d->mNextSerial++, item}, changes);
+    return changes.changedItems();
+}
+
+QList<CellItem *> CellItemLayout::remove(CellItem *item)
+{
+    if (!contains(item)) {
+        return {};
+    }
+
+    Changes changes;
+    (void)d->takeEntry(item, changes);
+    return changes.changedItems();
+}
+
+QList<CellItem *> CellItemLayout::move(CellItem *item, qint64 start, qint64 end)
+{
+    if (!contains(item)) {
+        return {};
+    }
+
+    Changes changes;
+    Entry entry = d->takeEntry(item, changes);
+    entry.start = start;
+    entry.end = end;
+    entry.serial = d->mNextSerial++;
+    d->insertEntry(entry, changes);
+    return changes.changedItems();
+}
+
+bool CellItemLayout::contains(CellItem *item) const
+{
+    return d->mClusterOfItem.contains(item);
+}
+
+qsizetype CellItemLayout::count() const
+{
+    return d->mClusterOfItem.size();
+}
+
+void CellItemLayout::clear()
+{
+    d->mClusters.clear();
+    d->mClusterOfItem.clear();
+}
@@ -0,0 +1,77 @@
+/*
+  SPDX-FileCopyrightText: 2026 KDE PIM Authors
+
+  SPDX-License-Identifier: GPL-2.0-or-later WITH Qt-Commercial-exception-1.0
+*/
+
+#pragma once
+
+#include "calendarsupport_export.h"
+
+#include <QList>
+
+#include <memory>
+
+namespace CalendarSupport
+{
+class CellItem;
+class CellItemLayoutPrivate;
+
+/**
+  Keeps the subcells of a set of cell items up to date while single items are
+  inserted, removed or moved.
+
+  Only the cluster of transitively overlapping items touched by a change is
+  laid out again, so the cost of an edit depends on the size of that cluster
+  rather than on the number of items in the layout.  The resulting subcells
+  are identical to CellItem::placeItems() applied to all items sorted by
+  range start, then range end, then insertion order, where a moved item
+  counts as inserted last.
+
+  All items must provide a range, see CellItem::hasRange().  The layout does
+  not take ownership of its items.
+*/
+class CALENDARSUPPORT_EXPORT CellItemLayout
+{
+public:
+    CellItemLayout();
+    ~CellItemLayout();
+
+    /**
+      Adds @p item to the layout, using its current range.  If @p item is
+      already part of the layout, it is moved to its current range instead.
+
+      @return The items whose subcell or number of subcells changed,
+      including @p item.
+    */
+    QList<CellItem *> insert(CellItem *item);
+
+    /**
+      Removes @p item from the layout.  The subcells of @p item itself are left
+      untouched.
+
+      @return The remaining items whose subcell or number of subcells changed.
+    */
+    QList<CellItem *> remove(CellItem *item);
+
+    /**
+      Moves @p item to the range [@p start, @p end).  From now on the layout
+      uses this range for @p item, whatever its rangeStart() and rangeEnd()
+      return.
+
+      @return The items whose subcell or number of subcells changed.
+    */
+    QList<CellItem *> move(CellItem *item, qint64 start, qint64 end);
+
+    [[nodiscard]] bool contains(CellItem *item) const;
+    [[nodiscard]] qsizetype count() const;
+
+    /**
+      Removes all items from the layout, leaving their subcells untouched.
+    */
+    void clear();
+
+private:
+    std::unique_ptr<CellItemLayoutPrivate> const d;
+};
+}
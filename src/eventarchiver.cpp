@@ -8,6 +8,7 @@
 
 #include "eventarchiver.h"
 
+#include "archivefileappender.h"
 #include "kcalprefs.h"
 
 #include <Akonadi/CalendarUtils>
@@ -26,10 +27,14 @@
 #include <KLocalizedString>
 #include <KMessageBox>
 
+#include <QHash>
 #include <QLocale>
+#include <QSet>
 #include <QTemporaryFile>
 #include <QTimeZone>
 
+#include <vector>
+
 using namespace KCalendarCore;
 using namespace KCalUtils;
 using namespace CalendarSupport;
@@ -107,14 +112,7 @@ void EventArchiver::run(const Akonadi::ETMCalendar::Ptr &calendar,
                                      true);
     }
     if (KCalPrefs::instance()->mArchiveTodos) {
-        const KCalendarCore::Todo::List rawTodos = calendar->rawTodos();
-
-        for (const KCalendarCore::Todo::Ptr &todo : rawTodos) {
-            Q_ASSERT(todo);
-            if (isSubTreeComplete(calendar, todo, limitDate)) {
-                todos.append(todo);
-            }
-        }
+        todos = todosWithCompleteSubTree(calendar->rawTodos(), limitDate);
     }
 
     const KCalendarCore::Incidence::List incidences = calendar->mergeIncidenceList(events, todos, journals);
@@ -179,51 +177,32 @@ void EventArchiver::archiveIncidences(const Akonadi::ETMCalendar::Ptr &calendar,
     Q_UNUSED(limitDate)
     Q_UNUSED(withGUI)
 
-    FileStorage storage(calendar);
+    // Only the incidences to archive are serialized, together with the
+    // exceptions of recurring ones; the live calendar is never copied.
+    MemoryCalendar::Ptr archiveCalendar(new MemoryCalendar(QTimeZone::systemTimeZone()));
+    QSet<QString> uids;
+    uids.reserve(incidences.count());
+    for (const KCalendarCore::Incidence::Ptr &incidence : incidences) {
+        if (uids.contains(incidence->uid())) {
+            continue;
+        }
+        uids.insert(incidence->uid());
 
-    QString tmpFileName;
-    // KSaveFile cannot be called with an open File Handle on Windows.
-    // So we use QTemporaryFile only to generate a unique filename
-    // and then close/delete the file again. This file must be deleted
-    // here.
-    {
-        QTemporaryFile tmpFile;
-        tmpFile.open();
-        tmpFileName = tmpFile.fileName();
-    }
-    // Save current calendar to disk
-    storage.setFileName(tmpFileName);
-    if (!storage.save()) {
-        qCDebug(CALENDARSUPPORT_LOG) << "Can't save calendar to temp file";
-        return;
+        const KCalendarCore::Incidence::Ptr main = calendar->incidence(incidence->uid());
+        if (!main) {
+            archiveCalendar->addIncidence(KCalendarCore::Incidence::Ptr(incidence->clone()));
+            continue;
+        }
+        archiveCalendar->addIncidence(KCalendarCore::Incidence::Ptr(main->clone()));
+        const KCalendarCore::Incidence::List exceptions = calendar->instances(main);
+        for (const KCalendarCore::Incidence::Ptr &exception : exceptions) {
+            archiveCalendar->addIncidence(KCalendarCore::Incidence::Ptr(exception->clone()));
+        }
     }
 
-    // Duplicate current calendar by loading in new calendar object
-    MemoryCalendar::Ptr archiveCalendar(new MemoryCalendar(QTimeZone::systemTimeZone()));
-
     FileStorage archiveStore(archiveCalendar);
-    archiveStore.setFileName(tmpFileName);
     auto format = new ICalFormat();
     archiveStore.setSaveFormat(format);
-    if (!archiveStore.load()) {
-        qCDebug(CALENDARSUPPORT_LOG) << "Can't load calendar from temp file";
-        QFile::remove(tmpFileName);
-        return;
-    }
-
-    // Strip active events from calendar so that only events to be archived
-    // remain. This is not really efficient, but there is no other easy way.
-    QStringList uids;
-    Incidence::List allIncidences = archiveCalendar->rawIncidences();
-    uids.reserve(incidences.count());
-    for (const KCalendarCore::Incidence::Ptr &incidence : std::as_const(incidences)) {
-        uids.append(incidence->uid());
-    }
-    for (const KCalendarCore::Incidence::Ptr &incidence : std::as_const(allIncidences)) {
-        if (!uids.contains(incidence->uid())) {
-            archiveCalendar->deleteIncidence(incidence);
-        }
-    }
 
     // Get or create the archive file
     QUrl archiveURL(KCalPrefs::instance()->mArchiveFile);
@@ -240,52 +219,81 @@ void EventArchiver::archiveIncidences(const Akonadi::ETMCalendar::Ptr &calendar,
         fileExists = job->exec();
     }
 
-    if (fileExists) {
-        archiveFile = downloadTempFile.fileName();
-        auto job = KIO::file_copy(archiveURL, QUrl::fromLocalFile(archiveFile));
-        KJobWidgets::setWindow(job, widget);
-        if (!job->exec()) {
-            qCDebug(CALENDARSUPPORT_LOG) << "Can't download archive file";
-            QFile::remove(tmpFileName);
-            return;
-        }
-        // Merge with events to be archived.
-        archiveStore.setFileName(archiveFile);
-        if (!archiveStore.load()) {
-            qCDebug(CALENDARSUPPORT_LOG) << "Can't merge with archive file";
-            QFile::remove(tmpFileName);
+    ArchiveFileAppender::Result appendResult = ArchiveFileAppender::NeedsMerge;
+    if (fileExists && archiveURL.isLocalFile()) {
+        // Write the new incidences at the end of a local archive instead of
+        // loading and saving all of it. Remote archives are always merged.
+        ArchiveFileAppender appender(archiveURL.toLocalFile());
+        appendResult = appender.append(archiveCalendar);
+        if (appendResult == ArchiveFileAppender::Failed) {
+            KMessageBox::error(widget, i18n("Cannot write archive file %1. %2", appender.archiveFile(), appender.errorString()));
             return;
         }
-    } else {
-        archiveFile = tmpFileName;
     }
 
-    // Save archive calendar
-    if (!archiveStore.save()) {
-        QString errmess;
-        if (format->exception()) {
-            errmess = Stringify::errorMessage(*format->exception());
+    if (appendResult == ArchiveFileAppender::NeedsMerge) {
+        QString tmpFileName;
+        if (fileExists) {
+            archiveFile = downloadTempFile.fileName();
+            auto job = KIO::file_copy(archiveURL, QUrl::fromLocalFile(archiveFile));
+            KJobWidgets::setWindow(job, widget);
+            if (!job->exec()) {
+                qCDebug(CALENDARSUPPORT_LOG) << "Can't download archive file";
+                return;
+            }
+            // Merge with events to be archived.
+            archiveStore.setFileName(archiveFile);
+            if (!archiveStore.load()) {
+                qCDebug(CALENDARSUPPORT_LOG) << "Can't merge with archive file";
+                return;
+            }
         } else {
-            errmess = i18nc("save failure cause unknown", "Reason unknown");
+            // KSaveFile cannot be called with an open File Handle on Windows.
+            // So we use QTemporaryFile only to generate a unique filename
+            // and then close/delete the file again. This file must be deleted
+            // here.
+            {
+                QTemporaryFile tmpFile;
+                tmpFile.open();
+                tmpFileName = tmpFile.fileName();
+            }
+            archiveStore.setFileName(tmpFileName);
+            archiveFile = tmpFileName;
         }
-        KMessageBox::error(widget, i18n("Cannot write archive file %1. %2", archiveStore.fileName(), errmess));
-        QFile::remove(tmpFileName);
-        return;
-    }
 
-    // Upload if necessary
-    QUrl srcUrl = QUrl::fromLocalFile(archiveFile);
-    if (srcUrl != archiveURL) {
-        auto job = KIO::file_copy(QUrl::fromLocalFile(archiveFile), archiveURL);
-        KJobWidgets::setWindow(job, widget);
-        if (!job->exec()) {
-            KMessageBox::error(widget, i18n("Cannot write archive. %1", job->errorString()));
-            QFile::remove(tmpFileName);
+        // Save archive calendar
+        if (!archiveStore.save()) {
+            QString errmess;
+            if (format->exception()) {
+                errmess = Stringify::errorMessage(*format->exception());
+            } else {
+                errmess = i18nc("save failure cause unknown", "Reason unknown");
+            }
+            KMessageBox::error(widget, i18n("Cannot write archive file %1. %2", archiveStore.fileName(), errmess));
+            if (!tmpFileName.isEmpty()) {
+                QFile::remove(tmpFileName);
+            }
             return;
         }
-    }
 
-    QFile::remove(tmpFileName);
+        // Upload if necessary
+        QUrl srcUrl = QUrl::fromLocalFile(archiveFile);
+        if (srcUrl != archiveURL) {
+            auto job = KIO::file_copy(QUrl::fromLocalFile(archiveFile), archiveURL);
+            KJobWidgets::setWindow(job, widget);
+            if (!job->exec()) {
+                KMessageBox::error(widget, i18n("Cannot write archive. %1", job->errorString()));
+                if (!tmpFileName.isEmpty()) {
+                    QFile::remove(tmpFileName);
+                }
+                return;
+            }
+        }
+
+        if (!tmpFileName.isEmpty()) {
+            QFile::remove(tmpFileName);
+        }
+    }
 
     // We don't want it to ask to send invitations for each incidence.
     changer->startAtomicOperation(i18n("Archiving events"));
@@ -300,29 +308,97 @@ void EventArchiver::archiveIncidences(const Akonadi::ETMCalendar::Ptr &calendar,
     Q_EMIT eventsDeleted();
 }
 
-bool EventArchiver::isSubTreeComplete(const Akonadi::ETMCalendar::Ptr &calendar, const Todo::Ptr &todo, QDate limitDate, QStringList checkedUids) const
+KCalendarCore::Todo::List EventArchiver::todosWithCompleteSubTree(const KCalendarCore::Todo::List &todos, QDate limitDate) const
 {
-    if (!todo->isCompleted() || todo->completed().date() >= limitDate) {
-        return false;
+    enum State : char {
+        Unvisited,
+        Visiting,
+        Complete,
+        Incomplete,
+    };
+
+    // Children are looked up by the UID of their parent, so that every
+    // to-do is visited once, however deep the hierarchy is.
+    QHash<QString, QList<int>> children;
+    children.reserve(todos.count());
+    for (int i = 0; i < todos.count(); ++i) {
+        Q_ASSERT(todos.at(i));
+        const QString parentUid = todos.at(i)->relatedTo();
+        if (!parentUid.isEmpty()) {
+            children[parentUid].append(i);
+        }
     }
 
-    // This QList is only to prevent infinite recursion
-    if (checkedUids.contains(todo->uid())) {
-        // Probably will never happen, calendar.cpp checks for this
-        qCWarning(CALENDARSUPPORT_LOG) << "To-do hierarchy loop detected!";
-        return false;
-    }
+    std::vector<State> states(todos.count(), Unvisited);
+    const auto visit = [&todos, &states, limitDate](int index) {
+        const Todo::Ptr &todo = todos.at(index);
+        const bool completed = todo->isCompleted() && todo->completed().date() < limitDate;
+        states[index] = completed ? Visiting : Incomplete;
+        return completed;
+    };
+
+    // Depth first, bottom up; a to-do is complete once all of its children are.
+    // The children of a to-do are looked up once, when its frame is pushed;
+    // children is not modified while the frames point into it.
+    struct Frame {
+        int index;
+        const QList<int> *childIndexes;
+        qsizetype nextChild;
+        bool complete;
+    };
+    const QList<int> noChildren;
+    const auto frameFor = [&todos, &children, &noChildren](int index) {
+        const auto it = children.constFind(todos.at(index)->uid());
+        return Frame{index, it != children.cend() ? &it.value() : &noChildren, 0, true};
+    };
+    std::vector<Frame> stack;
+    for (int root = 0; root < todos.count(); ++root) {
+        if (states[root] != Unvisited || !visit(root)) {
+            continue;
+        }
+        stack.push_back(frameFor(root));
+        while (!stack.empty()) {
+            Frame &frame = stack.back();
+            if (frame.complete && frame.nextChild < frame.childIndexes->size()) {
+                const int child = frame.childIndexes->at(frame.nextChild++);
+                switch (states[child]) {
+                case Unvisited:
+                    if (visit(child)) {
+                        stack.push_back(frameFor(child));
+                    } else {
+                        frame.complete = false;
+                    }
+                    break;
+                case Visiting:
+                    // Probably will never happen, calendar.cpp checks for this
+                    qCWarning(CALENDARSUPPORT_LOG) << "To-do hierarchy loop detected!";
+                    frame.complete = false;
+                    break;
+                case Complete:
+                    break;
+                case Incomplete:
+                    frame.complete = false;
+                    break;
+                }
+                continue;
+            }
 
-    checkedUids.append(todo->uid());
-    const KCalendarCore::Incidence::List children = calendar->childIncidences(todo->uid());
-    for (const KCalendarCore::Incidence::Ptr &incidence : children) {
-        const Todo::Ptr t = incidence.dynamicCast<KCalendarCore::Todo>();
-        if (t && !isSubTreeComplete(calendar, t, limitDate, checkedUids)) {
-            return false;
+            const bool complete = frame.complete;
+            states[frame.index] = complete ? Complete : Incomplete;
+            stack.pop_back();
+            if (!complete && !stack.empty()) {
+                stack.back().complete = false;
+            }
         }
     }
 
-    return true;
+    KCalendarCore::Todo::List completeTodos;
+    for (int i = 0; i < todos.count(); ++i) {
+        if (states[i] == Complete) {
+            completeTodos.append(todos.at(i));
+        }
+    }
+    return completeTodos;
 }
 
 #include "moc_eventarchiver.cpp"
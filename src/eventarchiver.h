@@ -80,15 +80,13 @@ private:
                                                      bool withGUI);
 
     /**
-     * Checks if all to-dos under @p todo and including @p todo were completed before @p limitDate.
-     * If not, we can't archive this to-do.
-     * @param todo root of the sub-tree we are checking
+     * Returns the to-dos of @p todos for which all to-dos under and including them were completed
+     * before @p limitDate. Other to-dos can't be archived.
+     * Every to-do is checked once; to-dos in a hierarchy loop, found in invalid calendar files,
+     * are never complete.
+     * @param todos all to-dos of the calendar
      * @param limitDate
-     * @param checkedUids used internally to prevent infinite recursion due to invalid calendar files
      */
-    CALENDARSUPPORT_NO_EXPORT bool isSubTreeComplete(const Akonadi::ETMCalendar::Ptr &calendar,
-                                                     const KCalendarCore::Todo::Ptr &todo,
-                                                     QDate limitDate,
-                                                     QStringList checkedUids = QStringList()) const;
+    CALENDARSUPPORT_NO_EXPORT KCalendarCore::Todo::List todosWithCompleteSubTree(const KCalendarCore::Todo::List &todos, QDate limitDate) const;
 };
 }
@@ -0,0 +1,88 @@
+/*
+  SPDX-FileCopyrightText: 2026 KDE PIM Authors
+
+  SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "testbusyhistogram.h"
+#include "../busyhistogram.h"
+#include "../freebusyitem.h"
+#include "../freebusyitemmodel.h"
+
+#include <KCalendarCore/Attendee>
+
+#include <QTest>
+
+using namespace CalendarSupport;
+
+QTEST_GUILESS_MAIN(BusyHistogramTest)
+
+static QDateTime at(int hour, int minute = 0)
+{
+    return QDateTime(QDate(2010, 7, 26), QTime(hour, minute), Qt::UTC);
+}
+
+static KCalendarCore::FreeBusyPeriod period(const QDateTime &start, const QDateTime &end, KCalendarCore::FreeBusyPeriod::FreeBusyType type)
+{
+    KCalendarCore::FreeBusyPeriod period(start, end);
+    period.setType(type);
+    return period;
+}
+
+void BusyHistogramTest::testCounts()
+{
+    using KCalendarCore::FreeBusyPeriod;
+    const QList<FreeBusyPeriod::List> busyPeriods = {
+        // Overlapping periods of one attendee count once
+        {period(at(8), at(10), FreeBusyPeriod::Busy), period(at(9), at(11), FreeBusyPeriod::Busy)},
+        {period(at(9, 30), at(10), FreeBusyPeriod::BusyTentative), period(at(12), at(14), FreeBusyPeriod::Busy)},
+        // Free periods are not busy, periods out of the window are cut
+        {period(at(6), at(9), FreeBusyPeriod::Busy), period(at(10), at(12), FreeBusyPeriod::Free)},
+    };
+
+    const BusyHistogram histogram = BusyHistogram::fromBusyPeriods(busyPeriods, at(8), at(13), 60);
+    QVERIFY(histogram.isValid());
+    QCOMPARE(histogram.slotCount(), 5);
+    QCOMPARE(histogram.slotStart(2), at(10));
+    QCOMPARE(histogram.busyCounts(), QList<int>({2, 2, 1, 0, 1}));
+    QCOMPARE(histogram.maximumBusyCount(), 2);
+    // Without counts per type
+    QCOMPARE(histogram.busyCount(0, FreeBusyPeriod::Busy), 0);
+}
+
+void BusyHistogramTest::testCountsByType()
+{
+    using KCalendarCore::FreeBusyPeriod;
+    const QList<FreeBusyPeriod::List> busyPeriods = {
+        {period(at(8), at(9), FreeBusyPeriod::Busy), period(at(8), at(10), FreeBusyPeriod::BusyTentative)},
+        {period(at(8, 30), at(9, 30), FreeBusyPeriod::BusyTentative), period(at(9), at(10), FreeBusyPeriod::Free)},
+    };
+
+    const BusyHistogram histogram = BusyHistogram::fromBusyPeriods(busyPeriods, at(8), at(10), 30, true);
+    QCOMPARE(histogram.busyCounts(), QList<int>({1, 2, 2, 1}));
+    for (int slot = 0; slot < 4; ++slot) {
+        QCOMPARE(histogram.busyCount(slot, FreeBusyPeriod::Busy), slot < 2 ? 1 : 0);
+        QCOMPARE(histogram.busyCount(slot, FreeBusyPeriod::BusyTentative), slot == 0 || slot == 3 ? 1 : 2);
+        QCOMPARE(histogram.busyCount(slot, FreeBusyPeriod::Free), slot < 2 ? 0 : 1);
+        QCOMPARE(histogram.busyCount(slot, FreeBusyPeriod::BusyUnavailable), 0);
+    }
+}
+
+void BusyHistogramTest::testFromModel()
+{
+    FreeBusyItemModel model;
+    KCalendarCore::FreeBusy::Ptr fb1(new KCalendarCore::FreeBusy());
+    fb1->addPeriod(at(9), at(11));
+    KCalendarCore::FreeBusy::Ptr fb2(new KCalendarCore::FreeBusy());
+    fb2->addPeriod(at(10), at(12));
+    FreeBusyItem::Ptr item1(new FreeBusyItem(KCalendarCore::Attendee(QStringLiteral("fred"), QStringLiteral("fred@example.com")), nullptr));
+    item1->setFreeBusy(fb1);
+    FreeBusyItem::Ptr item2(new FreeBusyItem(KCalendarCore::Attendee(QStringLiteral("joe"), QStringLiteral("joe@example.com")), nullptr));
+    item2->setFreeBusy(fb2);
+    model.addItems({item1, item2});
+
+    const BusyHistogram histogram = BusyHistogram::fromModel(&model, at(8), at(13), 60);
+    QCOMPARE(histogram.busyCounts(), QList<int>({0, 1, 2, 1, 0}));
+}
+
+#include "moc_testbusyhistogram.cpp"
@@ -0,0 +1,21 @@
+/*
+  SPDX-FileCopyrightText: 2026 KDE PIM Authors
+
+  SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <QObject>
+
+namespace CalendarSupport
+{
+class BusyHistogramTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testCounts();
+    void testCountsByType();
+    void testFromModel();
+};
+}
@@ -0,0 +1,123 @@
+/*
+  SPDX-FileCopyrightText: 2026 KDE PIM Authors
+
+  SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "testbusyslotbitmap.h"
+#include "../busyslotbitmap.h"
+#include "../freebusyitem.h"
+#include "../freebusyitemmodel.h"
+
+#include <KCalendarCore/Attendee>
+
+#include <QTest>
+
+using namespace CalendarSupport;
+
+QTEST_GUILESS_MAIN(BusySlotBitmapTest)
+
+static QDateTime at(int day, int hour, int minute = 0)
+{
+    return QDateTime(QDate(2010, 7, 26).addDays(day), QTime(hour, minute), Qt::UTC);
+}
+
+static QList<int> busySlots(const BusySlotBitmap &bitmap)
+{
+    QList<int> slots;
+    for (int i = 0; i < bitmap.slotCount(); ++i) {
+        if (bitmap.isBusy(i)) {
+            slots.append(i);
+        }
+    }
+    return slots;
+}
+
+void BusySlotBitmapTest::testMarkBusy()
+{
+    BusySlotBitmap bitmap(at(0, 0), at(1, 0), 15);
+    QVERIFY(bitmap.isValid());
+    QCOMPARE(bitmap.slotCount(), 96);
+    QCOMPARE(bitmap.busyCount(), 0);
+
+    // Partly covered slots are busy as well
+    bitmap.markBusy(at(0, 1, 10), at(0, 1, 31));
+    QCOMPARE(busySlots(bitmap), QList<int>({4, 5, 6}));
+
+    // Periods reaching out of the window are cut
+    bitmap.markBusy(at(-1, 22), at(0, 0, 15));
+    bitmap.markBusy(at(0, 23, 45), at(1, 3));
+    QCOMPARE(busySlots(bitmap), QList<int>({0, 4, 5, 6, 95}));
+
+    // Across word boundaries
+    bitmap.markBusy(at(0, 15), at(0, 17));
+    QCOMPARE(bitmap.busyCount(), 5 + 8);
+    QVERIFY(bitmap.isBusy(63));
+    QVERIFY(bitmap.isBusy(64));
+    QVERIFY(!bitmap.isBusy(68));
+
+    bitmap.setBusy(0, false);
+    QVERIFY(!bitmap.isBusy(0));
+}
+
+void BusySlotBitmapTest::testCombine()
+{
+    BusySlotBitmap fred(at(0, 0), at(0, 12), 30);
+    fred.markBusy(at(0, 1), at(0, 2));
+    BusySlotBitmap joe(at(0, 0), at(0, 12), 30);
+    joe.markBusy(at(0, 1, 30), at(0, 3));
+
+    BusySlotBitmap anyBusy = fred;
+    anyBusy |= joe;
+    QCOMPARE(busySlots(anyBusy), QList<int>({2, 3, 4, 5}));
+
+    BusySlotBitmap allBusy = fred;
+    allBusy &= joe;
+    QCOMPARE(busySlots(allBusy), QList<int>({3}));
+
+    const BusySlotBitmap free = ~anyBusy;
+    QCOMPARE(free.busyCount(), 24 - 4);
+}
+
+void BusySlotBitmapTest::testFindFreeSlots()
+{
+    BusySlotBitmap bitmap(at(0, 8), at(0, 12), 30);
+    bitmap.markBusy(at(0, 8, 30), at(0, 9, 30));
+    bitmap.markBusy(at(0, 10, 30), at(0, 11));
+
+    const KCalendarCore::Period::List hour = bitmap.findFreeSlots(2, 10);
+    QCOMPARE(hour.size(), 2);
+    QCOMPARE(hour.at(0), KCalendarCore::Period(at(0, 9, 30), at(0, 10, 30)));
+    QCOMPARE(hour.at(1), KCalendarCore::Period(at(0, 11), at(0, 12)));
+
+    QCOMPARE(bitmap.findFreeSlots(1, 2).size(), 2);
+    QCOMPARE(bitmap.findFreeSlots(1, 10).size(), 5);
+    QVERIFY(bitmap.findFreeSlots(3, 10).isEmpty());
+
+    // Free runs spanning many words
+    BusySlotBitmap week(at(0, 0), at(7, 0), 5);
+    week.markBusy(at(0, 0), at(3, 0));
+    const KCalendarCore::Period::List found = week.findFreeSlots(12, 1);
+    QCOMPARE(found.size(), 1);
+    QCOMPARE(found.at(0).start(), at(3, 0));
+}
+
+void BusySlotBitmapTest::testFromModel()
+{
+    FreeBusyItemModel model;
+    KCalendarCore::FreeBusy::Ptr fb1(new KCalendarCore::FreeBusy());
+    fb1->addPeriod(at(0, 9), at(0, 10));
+    KCalendarCore::FreeBusy::Ptr fb2(new KCalendarCore::FreeBusy());
+    fb2->addPeriod(at(0, 11), at(0, 12));
+    FreeBusyItem::Ptr item1(new FreeBusyItem(KCalendarCore::Attendee(QStringLiteral("fred"), QStringLiteral("fred@example.com")), nullptr));
+    item1->setFreeBusy(fb1);
+    FreeBusyItem::Ptr item2(new FreeBusyItem(KCalendarCore::Attendee(QStringLiteral("joe"), QStringLiteral("joe@example.com")), nullptr));
+    item2->setFreeBusy(fb2);
+    model.addItems({item1, item2});
+
+    const BusySlotBitmap bitmap = BusySlotBitmap::fromModel(&model, at(0, 8), at(0, 13), 60);
+    QCOMPARE(busySlots(bitmap), QList<int>({1, 3}));
+    QCOMPARE(bitmap.findFreeSlots(1, 10).size(), 3);
+}
+
+#include "moc_testbusyslotbitmap.cpp"
@@ -0,0 +1,22 @@
+/*
+  SPDX-FileCopyrightText: 2026 KDE PIM Authors
+
+  SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <QObject>
+
+namespace CalendarSupport
+{
+class BusySlotBitmapTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testMarkBusy();
+    void testCombine();
+    void testFindFreeSlots();
+    void testFromModel();
+};
+}
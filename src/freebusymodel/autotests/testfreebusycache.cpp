@@ -0,0 +1,146 @@
+/*
+  SPDX-FileCopyrightText: 2026 KDE PIM Authors
+
+  SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "testfreebusycache.h"
+#include "../freebusycache.h"
+#include "../freebusyitem.h"
+#include "../freebusyitemmodel.h"
+#include "../freebusyitemmodel_p.h"
+
+#include <KCalendarCore/Attendee>
+#include <KCalendarCore/FreeBusyPeriod>
+
+#include <QDataStream>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTest>
+
+using namespace CalendarSupport;
+
+QTEST_GUILESS_MAIN(FreeBusyCacheTest)
+
+static KCalendarCore::FreeBusy::Ptr createFreeBusy()
+{
+    KCalendarCore::FreeBusy::Ptr fb(new KCalendarCore::FreeBusy());
+    fb->addPeriod(QDateTime(QDate(2010, 7, 24), QTime(7, 0, 0), Qt::UTC), KCalendarCore::Duration(60 * 60));
+    fb->addPeriod(QDateTime(QDate(2010, 7, 24), QTime(10, 0, 0), Qt::UTC), KCalendarCore::Duration(60 * 60));
+    return fb;
+}
+
+void FreeBusyCacheTest::testRoundTrip()
+{
+    QTemporaryDir dir;
+    const QString fileName = dir.filePath(QStringLiteral("freebusy.cache"));
+    const KCalendarCore::FreeBusy::Ptr fb = createFreeBusy();
+    {
+        FreeBusyCache cache(fileName);
+        QVERIFY(!cache.freeBusy(QStringLiteral("fred@example.com")));
+        cache.insert(QStringLiteral("Fred@Example.com "), fb);
+        QVERIFY(cache.save());
+    }
+
+    FreeBusyCache cache(fileName);
+    const KCalendarCore::FreeBusy::Ptr cached = cache.freeBusy(QStringLiteral("fred@example.com"));
+    QVERIFY(cached);
+    QCOMPARE(cached->fullBusyPeriods().size(), 2);
+    QCOMPARE(cached->fullBusyPeriods().first().start(), fb->fullBusyPeriods().first().start());
+    QVERIFY(cache.fetchTime(QStringLiteral("fred@example.com")).isValid());
+
+    cache.remove(QStringLiteral("fred@example.com"));
+    QVERIFY(!cache.freeBusy(QStringLiteral("fred@example.com")));
+}
+
+void FreeBusyCacheTest::testExpiry()
+{
+    QTemporaryDir dir;
+    FreeBusyCache cache(dir.filePath(QStringLiteral("freebusy.cache")));
+    cache.setTimeToLive(60 * 60);
+    cache.insert(QStringLiteral("fred@example.com"), createFreeBusy(), QDateTime::currentDateTimeUtc().addSecs(-2 * 60 * 60));
+    cache.insert(QStringLiteral("joe@example.com"), createFreeBusy());
+    QVERIFY(!cache.freeBusy(QStringLiteral("fred@example.com")));
+    QVERIFY(cache.freeBusy(QStringLiteral("joe@example.com")));
+}
+
+void FreeBusyCacheTest::testDamagedFile()
+{
+    QTemporaryDir dir;
+    const QString fileName = dir.filePath(QStringLiteral("freebusy.cache"));
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write("not a cache");
+    file.close();
+
+    FreeBusyCache cache(fileName);
+    QVERIFY(!cache.freeBusy(QStringLiteral("fred@example.com")));
+    cache.insert(QStringLiteral("fred@example.com"), createFreeBusy());
+    QVERIFY(cache.save());
+}
+
+void FreeBusyCacheTest::testStoresOnlyTimes()
+{
+    QTemporaryDir dir;
+    const QString fileName = dir.filePath(QStringLiteral("freebusy.cache"));
+    const QDateTime start(QDate(2010, 7, 24), QTime(7, 0, 0), Qt::UTC);
+    KCalendarCore::FreeBusyPeriod period(start, start.addSecs(60 * 60));
+    period.setSummary(QStringLiteral("Job interview"));
+    period.setLocation(QStringLiteral("Room 42"));
+    period.setType(KCalendarCore::FreeBusyPeriod::BusyTentative);
+    {
+        FreeBusyCache cache(fileName);
+        cache.insert(QStringLiteral("fred@example.com"), KCalendarCore::FreeBusy::Ptr(new KCalendarCore::FreeBusy(KCalendarCore::FreeBusyPeriod::List{period})));
+        QVERIFY(cache.save());
+    }
+
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QCOMPARE(file.permissions() & (QFileDevice::ReadGroup | QFileDevice::ReadOther), QFileDevice::Permissions());
+    // Neither as UTF-8 nor the way QDataStream writes strings
+    QByteArray serialized;
+    {
+        QDataStream stream(&serialized, QIODevice::WriteOnly);
+        stream << period.summary();
+    }
+    const QByteArray contents = file.readAll();
+    QVERIFY(!contents.contains(period.summary().toUtf8()));
+    QVERIFY(!contents.contains(serialized.mid(sizeof(quint32))));
+
+    FreeBusyCache cache(fileName);
+    const KCalendarCore::FreeBusy::Ptr cached = cache.freeBusy(QStringLiteral("fred@example.com"));
+    QVERIFY(cached);
+    QCOMPARE(cached->fullBusyPeriods().size(), 1);
+    const KCalendarCore::FreeBusyPeriod loaded = cached->fullBusyPeriods().first();
+    QCOMPARE(loaded.start(), period.start());
+    QCOMPARE(loaded.end(), period.end());
+    QCOMPARE(loaded.type(), KCalendarCore::FreeBusyPeriod::BusyTentative);
+    QVERIFY(loaded.summary().isEmpty());
+    QVERIFY(loaded.location().isEmpty());
+}
+
+void FreeBusyCacheTest::testModelWarmStart()
+{
+    QTemporaryDir dir;
+    FreeBusyCache cache(dir.filePath(QStringLiteral("freebusy.cache")));
+    cache.insert(QStringLiteral("fred@example.com"), createFreeBusy());
+
+    FreeBusyItemModel model;
+    FreeBusyItemModelPrivate::get(&model)->mCache = &cache;
+    KCalendarCore::Attendee a1(QStringLiteral("fred"), QStringLiteral("fred@example.com"));
+    FreeBusyItem::Ptr item1(new FreeBusyItem(a1, nullptr));
+    model.addItem(item1);
+
+    // The periods are there before any retrieval finished.
+    QVERIFY(item1->freeBusy());
+    QCOMPARE(model.rowCount(model.index(0, 0)), 2);
+
+    // Retrieved data goes to the cache.
+    KCalendarCore::FreeBusy::Ptr fb(new KCalendarCore::FreeBusy());
+    fb->addPeriod(QDateTime(QDate(2010, 7, 25), QTime(7, 0, 0), Qt::UTC), KCalendarCore::Duration(60 * 60));
+    model.slotInsertFreeBusy(fb, QStringLiteral("fred@example.com"));
+    QCOMPARE(cache.freeBusy(QStringLiteral("fred@example.com")), fb);
+    QCOMPARE(model.rowCount(model.index(0, 0)), 1);
+}
+
+#include "moc_testfreebusycache.cpp"
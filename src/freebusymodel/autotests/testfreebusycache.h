@@ -0,0 +1,23 @@
+/*
+  SPDX-FileCopyrightText: 2026 KDE PIM Authors
+
+  SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <QObject>
+
+namespace CalendarSupport
+{
+class FreeBusyCacheTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testRoundTrip();
+    void testExpiry();
+    void testDamagedFile();
+    void testStoresOnlyTimes();
+    void testModelWarmStart();
+};
+}
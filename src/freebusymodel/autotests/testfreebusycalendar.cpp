@@ -0,0 +1,170 @@
+/*
+  SPDX-FileCopyrightText: 2026 KDE PIM Authors
+
+  SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "testfreebusycalendar.h"
+#include "../freebusycalendar.h"
+#include "../freebusyitem.h"
+#include "../freebusyitemmodel.h"
+
+#include <KCalendarCore/Attendee>
+
+#include <QSignalSpy>
+#include <QTest>
+#include <QTimeZone>
+
+using namespace CalendarSupport;
+
+QTEST_GUILESS_MAIN(FreeBusyCalendarTest)
+
+static QDateTime at(int hour)
+{
+    return QDateTime(QDate(2010, 7, 26), QTime(hour, 0), Qt::UTC);
+}
+
+static FreeBusyItem::Ptr createItem(const QString &name, const QList<int> &busyHours)
+{
+    KCalendarCore::FreeBusy::Ptr fb(new KCalendarCore::FreeBusy());
+    for (const int hour : busyHours) {
+        fb->addPeriod(at(hour), at(hour + 1));
+    }
+    FreeBusyItem::Ptr item(new FreeBusyItem(KCalendarCore::Attendee(name, name + QStringLiteral("@example.com")), nullptr));
+    item->setFreeBusy(fb);
+    return item;
+}
+
+void FreeBusyCalendarTest::testEventsFollowModel()
+{
+    FreeBusyItemModel model;
+    model.addItem(createItem(QStringLiteral("fred"), {8, 10}));
+
+    FreeBusyCalendar calendar;
+    calendar.setModel(&model);
+    QCOMPARE(calendar.calendar()->events().size(), 2);
+
+    model.addItems({createItem(QStringLiteral("joe"), {9}), createItem(QStringLiteral("jane"), {11, 12, 13})});
+    QTRY_COMPARE(calendar.calendar()->events().size(), 6);
+
+    model.removeRow(0);
+    QTRY_COMPARE(calendar.calendar()->events().size(), 4);
+
+    model.clear();
+    QTRY_VERIFY(calendar.calendar()->events().isEmpty());
+}
+
+void FreeBusyCalendarTest::testStableEvents()
+{
+    FreeBusyItemModel model;
+    model.addItems({createItem(QStringLiteral("fred"), {8, 10}), createItem(QStringLiteral("joe"), {9})});
+    FreeBusyCalendar calendar;
+    calendar.setModel(&model);
+
+    const auto joeEvents = calendar.calendar()->events(at(9).date(), QTimeZone::utc());
+    KCalendarCore::Event::Ptr joeEvent;
+    for (const auto &event : joeEvents) {
+        if (event->dtStart() == at(9)) {
+            joeEvent = event;
+        }
+    }
+    QVERIFY(joeEvent);
+
+    // Fred's rows move, joe's event stays the same object
+    model.removeRow(0);
+    QTRY_COMPARE(calendar.calendar()->events().size(), 1);
+    QCOMPARE(calendar.calendar()->events().first(), joeEvent);
+
+    // A refresh changing one period replaces only that event
+    KCalendarCore::FreeBusy::Ptr fb(new KCalendarCore::FreeBusy());
+    fb->addPeriod(at(9), at(10));
+    fb->addPeriod(at(14), at(15));
+    model.slotInsertFreeBusy(fb, QStringLiteral("joe@example.com"));
+    QTRY_COMPARE(calendar.calendar()->events().size(), 2);
+    QVERIFY(calendar.calendar()->events().contains(joeEvent));
+}
+
+void FreeBusyCalendarTest::testMaterializedRange()
+{
+    FreeBusyItemModel model;
+    model.addItems({createItem(QStringLiteral("fred"), {8, 10, 12}), createItem(QStringLiteral("joe"), {9, 15})});
+    FreeBusyCalendar calendar;
+    calendar.setMaterializedRange(at(9), at(12));
+    calendar.setModel(&model);
+
+    // 9 to 10 of joe and 10 to 11 of fred
+    QCOMPARE(calendar.calendar()->events().size(), 2);
+
+    calendar.setMaterializedRange(at(12), at(16));
+    QCOMPARE(calendar.calendar()->events().size(), 2);
+    for (const auto &event : calendar.calendar()->events()) {
+        QVERIFY(event->dtStart() >= at(12));
+    }
+
+    model.addItem(createItem(QStringLiteral("jane"), {7, 13}));
+    QTRY_COMPARE(calendar.calendar()->events().size(), 3);
+
+    calendar.setMaterializedRange(QDateTime(), QDateTime());
+    QCOMPARE(calendar.calendar()->events().size(), 7);
+}
+
+void FreeBusyCalendarTest::testBatchedUpdates()
+{
+    FreeBusyItemModel model;
+    FreeBusyCalendar calendar;
+    calendar.setModel(&model);
+    QSignalSpy updated(&calendar, &FreeBusyCalendar::calendarUpdated);
+
+    // A burst of model changes reaches the calendar as one update
+    model.addItem(createItem(QStringLiteral("fred"), {8, 10}));
+    model.addItem(createItem(QStringLiteral("joe"), {9}));
+    KCalendarCore::FreeBusy::Ptr fb(new KCalendarCore::FreeBusy());
+    fb->addPeriod(at(11), at(12));
+    model.slotInsertFreeBusy(fb, QStringLiteral("fred@example.com"));
+    QCOMPARE(updated.count(), 0);
+
+    QVERIFY(updated.wait());
+    QCOMPARE(updated.count(), 1);
+    QCOMPARE(calendar.calendar()->events().size(), 2);
+}
+
+void FreeBusyCalendarTest::testFlush()
+{
+    FreeBusyItemModel model;
+    model.addItems({createItem(QStringLiteral("fred"), {8, 10}), createItem(QStringLiteral("Joe"), {9})});
+    FreeBusyCalendar calendar;
+    calendar.setModel(&model);
+    QSignalSpy updated(&calendar, &FreeBusyCalendar::calendarUpdated);
+
+    // Pending changes are applied without waiting for the event loop
+    KCalendarCore::FreeBusy::Ptr fb(new KCalendarCore::FreeBusy());
+    fb->addPeriod(at(14), at(15));
+    fb->addPeriod(at(16), at(17));
+    model.slotInsertFreeBusy(fb, QStringLiteral("joe@example.com"));
+    QCOMPARE(calendar.calendar()->events().size(), 3);
+    calendar.flush();
+    QCOMPARE(updated.count(), 1);
+    QCOMPARE(calendar.calendar()->events().size(), 4);
+
+    // Nothing left to apply
+    calendar.flush();
+    QCOMPARE(updated.count(), 1);
+}
+
+void FreeBusyCalendarTest::testModelDeleted()
+{
+    auto model = new FreeBusyItemModel;
+    model->addItems({createItem(QStringLiteral("fred"), {8, 10}), createItem(QStringLiteral("Joe"), {9})});
+    FreeBusyCalendar calendar;
+    calendar.setModel(model);
+    QCOMPARE(calendar.calendar()->events().size(), 3);
+
+    // Changes queued by the model are not read from it after its deletion
+    model->removeRow(0);
+    delete model;
+    QVERIFY(!calendar.model());
+    calendar.flush();
+    QVERIFY(calendar.calendar()->events().isEmpty());
+}
+
+#include "moc_testfreebusycalendar.cpp"
@@ -0,0 +1,24 @@
+/*
+  SPDX-FileCopyrightText: 2026 KDE PIM Authors
+
+  SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <QObject>
+
+namespace CalendarSupport
+{
+class FreeBusyCalendarTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testEventsFollowModel();
+    void testStableEvents();
+    void testMaterializedRange();
+    void testBatchedUpdates();
+    void testFlush();
+    void testModelDeleted();
+};
+}
@@ -8,12 +8,16 @@
 #include "testfreebusyitemmodel.h"
 #include "../freebusyitem.h"
 #include "../freebusyitemmodel.h"
+#include "../freebusyitemmodel_p.h"
 
 #include <KCalendarCore/Attendee>
 
 #include <QAbstractItemModelTester>
+#include <QSignalSpy>
 #include <QTest>
 
+#include <functional>
+
 using namespace CalendarSupport;
 
 // Workaround QTBUG-51789 causing a crash when QtWebEngineWidgets
@@ -202,4 +206,439 @@ void FreeBusyItemModelTest::testInsertFreeBusy()
     QCOMPARE(model->rowCount(i), 4);
 }
 
+void FreeBusyItemModelTest::testLookupAfterRemoval()
+{
+    auto model = new FreeBusyItemModel(this);
+    new QAbstractItemModelTester(model, this);
+
+    const QDateTime dt1(QDate(2010, 7, 24), QTime(7, 0, 0), Qt::UTC);
+    KCalendarCore::Attendee a1(QStringLiteral("fred"), QStringLiteral("fred@example.com"));
+    KCalendarCore::Attendee a2(QStringLiteral("joe"), QStringLiteral("joe@example.com"));
+    KCalendarCore::Attendee a3(QStringLiteral("max"), QStringLiteral("Max@Example.com"));
+    FreeBusyItem::Ptr item1(new FreeBusyItem(a1, nullptr));
+    FreeBusyItem::Ptr item2(new FreeBusyItem(a2, nullptr));
+    FreeBusyItem::Ptr item3(new FreeBusyItem(a3, nullptr));
+    model->addItem(item1);
+    model->addItem(item2);
+    model->addItem(item3);
+
+    model->removeAttendee(a1);
+    QCOMPARE(model->rowCount(), 2);
+    QVERIFY(!model->containsAttendee(a1));
+    QVERIFY(model->containsAttendee(a2));
+    QVERIFY(model->containsAttendee(a3));
+
+    // Emails are matched case-insensitively, on the rows left after the removal.
+    KCalendarCore::FreeBusy::Ptr fb(new KCalendarCore::FreeBusy());
+    fb->addPeriod(dt1, KCalendarCore::Duration(60 * 60));
+    model->slotInsertFreeBusy(fb, QStringLiteral("max@example.com"));
+    QCOMPARE(item3->freeBusy(), fb);
+    QCOMPARE(model->rowCount(model->index(1, 0)), 1);
+    QCOMPARE(model->rowCount(model->index(0, 0)), 0);
+
+    model->removeItem(item2);
+    QCOMPARE(model->rowCount(), 1);
+    QVERIFY(model->containsAttendee(a3));
+    model->clear();
+    QVERIFY(!model->containsAttendee(a3));
+}
+
+void FreeBusyItemModelTest::testPeriodsSorted()
+{
+    auto model = new FreeBusyItemModel(this);
+    new QAbstractItemModelTester(model, this);
+
+    const QDateTime dt1(QDate(2010, 7, 24), QTime(7, 0, 0), Qt::UTC);
+    const QDateTime dt2(QDate(2010, 7, 24), QTime(10, 0, 0), Qt::UTC);
+    const QDateTime dt3(QDate(2010, 7, 24), QTime(12, 0, 0), Qt::UTC);
+    KCalendarCore::Attendee a1(QStringLiteral("fred"), QStringLiteral("fred@example.com"));
+    KCalendarCore::FreeBusy::Ptr fb1(new KCalendarCore::FreeBusy());
+    fb1->addPeriod(dt3, KCalendarCore::Duration(60 * 60));
+    fb1->addPeriod(dt1, KCalendarCore::Duration(60 * 60));
+    fb1->addPeriod(dt2, KCalendarCore::Duration(60 * 60));
+
+    FreeBusyItem::Ptr item1(new FreeBusyItem(a1, nullptr));
+    item1->setFreeBusy(fb1);
+    model->addItem(item1);
+
+    const QModelIndex parent = model->index(0, 0);
+    QCOMPARE(model->rowCount(parent), 3);
+    const QList<QDateTime> starts = {dt1, dt2, dt3};
+    for (int i = 0; i < starts.size(); ++i) {
+        const auto period = model->data(model->index(i, 0, parent), FreeBusyItemModel::FreeBusyPeriodRole).value<KCalendarCore::FreeBusyPeriod>();
+        QCOMPARE(period.start(), starts.at(i));
+    }
+    QVERIFY(!model->data(model->index(2, 0, parent), Qt::DisplayRole).toString().isEmpty());
+}
+
+void FreeBusyItemModelTest::testMinimalPeriodUpdates()
+{
+    auto model = new FreeBusyItemModel(this);
+    new QAbstractItemModelTester(model, this);
+
+    const QDateTime dt1(QDate(2010, 7, 24), QTime(7, 0, 0), Qt::UTC);
+    const QDateTime dt2(QDate(2010, 7, 24), QTime(10, 0, 0), Qt::UTC);
+    const QDateTime dt3(QDate(2010, 7, 24), QTime(12, 0, 0), Qt::UTC);
+    const QDateTime dt4(QDate(2010, 7, 24), QTime(15, 0, 0), Qt::UTC);
+    const KCalendarCore::Duration hour(60 * 60);
+    KCalendarCore::Attendee a1(QStringLiteral("fred"), QStringLiteral("fred@example.com"));
+    KCalendarCore::FreeBusy::Ptr fb1(new KCalendarCore::FreeBusy());
+    fb1->addPeriod(dt1, hour);
+    fb1->addPeriod(dt2, hour);
+    fb1->addPeriod(dt3, hour);
+
+    FreeBusyItem::Ptr item1(new FreeBusyItem(a1, nullptr));
+    item1->setFreeBusy(fb1);
+    model->addItem(item1);
+    const QModelIndex parent = model->index(0, 0);
+    QCOMPARE(model->rowCount(parent), 3);
+
+    QSignalSpy inserted(model, &QAbstractItemModel::rowsInserted);
+    QSignalSpy removed(model, &QAbstractItemModel::rowsRemoved);
+    QSignalSpy changed(model, &QAbstractItemModel::dataChanged);
+
+    const auto periodChanges = [&changed, &parent]() {
+        QList<std::pair<int, int>> ranges;
+        for (const auto &args : std::as_const(changed)) {
+            const auto topLeft = args.at(0).toModelIndex();
+            if (topLeft.parent() == parent) {
+                ranges.append({topLeft.row(), args.at(1).toModelIndex().row()});
+            }
+        }
+        changed.clear();
+        return ranges;
+    };
+
+    // The same periods again: nothing changes.
+    KCalendarCore::FreeBusy::Ptr fb2(new KCalendarCore::FreeBusy());
+    fb2->addPeriod(dt1, hour);
+    fb2->addPeriod(dt2, hour);
+    fb2->addPeriod(dt3, hour);
+    model->slotInsertFreeBusy(fb2, QStringLiteral("fred@example.com"));
+    QCOMPARE(inserted.count(), 0);
+    QCOMPARE(removed.count(), 0);
+    QVERIFY(periodChanges().isEmpty());
+
+    // One period got longer: only its row changes.
+    KCalendarCore::FreeBusy::Ptr fb3(new KCalendarCore::FreeBusy());
+    fb3->addPeriod(dt1, hour);
+    fb3->addPeriod(dt2, KCalendarCore::Duration(2 * 60 * 60));
+    fb3->addPeriod(dt3, hour);
+    model->slotInsertFreeBusy(fb3, QStringLiteral("fred@example.com"));
+    QCOMPARE(inserted.count(), 0);
+    QCOMPARE(removed.count(), 0);
+    QCOMPARE(periodChanges(), (QList<std::pair<int, int>>{{1, 1}}));
+    QCOMPARE(model->data(model->index(1, 0, parent), FreeBusyItemModel::FreeBusyPeriodRole).value<KCalendarCore::FreeBusyPeriod>().end(),
+             dt2.addSecs(2 * 60 * 60));
+
+    // A period was added at the end and the first one went away.
+    KCalendarCore::FreeBusy::Ptr fb4(new KCalendarCore::FreeBusy());
+    fb4->addPeriod(dt2, KCalendarCore::Duration(2 * 60 * 60));
+    fb4->addPeriod(dt3, hour);
+    fb4->addPeriod(dt4, hour);
+    model->slotInsertFreeBusy(fb4, QStringLiteral("fred@example.com"));
+    QCOMPARE(removed.count(), 1);
+    QCOMPARE(removed.at(0).at(1).toInt(), 0);
+    QCOMPARE(removed.at(0).at(2).toInt(), 0);
+    QCOMPARE(inserted.count(), 1);
+    QCOMPARE(inserted.at(0).at(1).toInt(), 2);
+    QCOMPARE(inserted.at(0).at(2).toInt(), 2);
+    QVERIFY(periodChanges().isEmpty());
+    QCOMPARE(model->rowCount(parent), 3);
+    QCOMPARE(model->data(model->index(2, 0, parent), FreeBusyItemModel::FreeBusyPeriodRole).value<KCalendarCore::FreeBusyPeriod>().start(), dt4);
+}
+
+void FreeBusyItemModelTest::testUpdateScheduling()
+{
+    auto model = new FreeBusyItemModel(this);
+
+    KCalendarCore::Attendee a1(QStringLiteral("fred"), QStringLiteral("fred@example.com"));
+    KCalendarCore::Attendee a2(QStringLiteral("joe"), QStringLiteral("joe@example.com"));
+    FreeBusyItem::Ptr item1(new FreeBusyItem(a1, nullptr));
+    FreeBusyItem::Ptr item2(new FreeBusyItem(a2, nullptr));
+    model->addItem(item1);
+    model->addItem(item2);
+
+    // Both updates are queued, without timers of their own, and not
+    // prioritized.
+    QVERIFY(FreeBusyItemModelPrivate::get(model)->hasPendingUpdate(item1));
+    QVERIFY(FreeBusyItemModelPrivate::get(model)->hasPendingUpdate(item2));
+    for (const auto &update : FreeBusyItemModelPrivate::get(model)->mPendingUpdates) {
+        QVERIFY(!update.prioritized);
+    }
+    QCOMPARE(item1->updateTimerID(), 0);
+    QCOMPARE(item2->updateTimerID(), 0);
+
+    // Removing an attendee drops its queued update.
+    model->removeAttendee(a1);
+    QVERIFY(!FreeBusyItemModelPrivate::get(model)->hasPendingUpdate(item1));
+    QVERIFY(FreeBusyItemModelPrivate::get(model)->hasPendingUpdate(item2));
+
+    model->clear();
+    QVERIFY(!FreeBusyItemModelPrivate::get(model)->hasPendingUpdate(item2));
+}
+
+void FreeBusyItemModelTest::testMaxConcurrentDownloads()
+{
+    auto model = new FreeBusyItemModel(this);
+    QCOMPARE(model->maxConcurrentDownloads(), 4);
+    model->setMaxConcurrentDownloads(10);
+    QCOMPARE(model->maxConcurrentDownloads(), 10);
+    // At least one download has to be able to run
+    model->setMaxConcurrentDownloads(0);
+    QCOMPARE(model->maxConcurrentDownloads(), 1);
+}
+
+static FreeBusyItem::Ptr itemForEmail(const QString &email)
+{
+    return FreeBusyItem::Ptr(new FreeBusyItem(KCalendarCore::Attendee(email, email), nullptr));
+}
+
+// Starts every retrieval, remembering the emails in the order they started
+static std::function<bool(const FreeBusyItem::Ptr &, bool)> recordRetrievals(QStringList &started)
+{
+    return [&started](const FreeBusyItem::Ptr &item, bool) {
+        started.append(item->email());
+        return true;
+    };
+}
+
+void FreeBusyItemModelTest::testDownloadCap()
+{
+    // Not parented, so that the retrieval functions capturing locals go
+    // away with them
+    FreeBusyItemModel model;
+    FreeBusyItemModelPrivate *const d = FreeBusyItemModelPrivate::get(&model);
+    QStringList started;
+    d->mRetrieve = recordRetrievals(started);
+    model.setMaxConcurrentDownloads(2);
+
+    QList<FreeBusyItem::Ptr> items;
+    for (const auto &email : {QStringLiteral("a@example.com"), QStringLiteral("b@example.com"), QStringLiteral("c@example.com")}) {
+        items.append(itemForEmail(email));
+        model.addItem(items.last());
+        d->queueDownload(items.last(), false, false);
+    }
+    QCOMPARE(d->mQueuedDownloads.size(), 3);
+    QVERIFY(!items.at(0)->isDownloading());
+
+    d->startQueuedDownloads();
+    QCOMPARE(started, QStringList({QStringLiteral("a@example.com"), QStringLiteral("b@example.com")}));
+    QCOMPARE(d->mRunningDownloads.size(), 2);
+    QCOMPARE(d->mQueuedDownloads.size(), 1);
+    QVERIFY(items.at(0)->isDownloading());
+    QVERIFY(!items.at(2)->isDownloading());
+
+    // A reply frees a slot for the queued download
+    model.slotInsertFreeBusy(KCalendarCore::FreeBusy::Ptr(), QStringLiteral("b@example.com"));
+    QCOMPARE(started.last(), QStringLiteral("c@example.com"));
+    QCOMPARE(d->mRunningDownloads.size(), 2);
+    QCOMPARE(d->mQueuedDownloads.size(), 0);
+    QVERIFY(!items.at(1)->isDownloading());
+    QVERIFY(items.at(2)->isDownloading());
+
+    // A retrieval that does not start does not take a slot
+    model.slotInsertFreeBusy(KCalendarCore::FreeBusy::Ptr(), QStringLiteral("a@example.com"));
+    model.slotInsertFreeBusy(KCalendarCore::FreeBusy::Ptr(), QStringLiteral("c@example.com"));
+    d->mRetrieve = [](const FreeBusyItem::Ptr &, bool) {
+        return false;
+    };
+    d->queueDownload(items.at(0), false, false);
+    d->startQueuedDownloads();
+    QCOMPARE(d->mRunningDownloads.size(), 0);
+    QCOMPARE(d->mQueuedDownloads.size(), 0);
+    QVERIFY(!items.at(0)->isDownloading());
+}
+
+void FreeBusyItemModelTest::testDownloadSharedEmail()
+{
+    FreeBusyItemModel model;
+    FreeBusyItemModelPrivate *const d = FreeBusyItemModelPrivate::get(&model);
+    QStringList started;
+    d->mRetrieve = recordRetrievals(started);
+
+    const FreeBusyItem::Ptr item1 = itemForEmail(QStringLiteral("fred@example.com"));
+    const FreeBusyItem::Ptr item2 = itemForEmail(QStringLiteral("Fred@Example.com"));
+    model.addItems({item1, item2});
+    d->queueDownload(item1, false, false);
+    d->queueDownload(item2, false, true);
+    QCOMPARE(d->mQueuedDownloads.size(), 1);
+
+    d->startQueuedDownloads();
+    QCOMPARE(started.size(), 1);
+    QCOMPARE(d->mRunningDownloads.size(), 1);
+    QVERIFY(item1->isDownloading());
+    QVERIFY(item2->isDownloading());
+
+    // Nothing is queued for an email that is being downloaded
+    d->queueDownload(item2, true, false);
+    QCOMPARE(d->mQueuedDownloads.size(), 0);
+
+    model.slotInsertFreeBusy(KCalendarCore::FreeBusy::Ptr(), QStringLiteral("FRED@example.com"));
+    QCOMPARE(d->mRunningDownloads.size(), 0);
+    QVERIFY(!item1->isDownloading());
+    QVERIFY(!item2->isDownloading());
+}
+
+void FreeBusyItemModelTest::testDownloadPriority()
+{
+    FreeBusyItemModel model;
+    FreeBusyItemModelPrivate *const d = FreeBusyItemModelPrivate::get(&model);
+    QStringList started;
+    d->mRetrieve = recordRetrievals(started);
+    model.setMaxConcurrentDownloads(1);
+
+    QList<FreeBusyItem::Ptr> items;
+    for (const auto &email : {QStringLiteral("a"), QStringLiteral("b"), QStringLiteral("c"), QStringLiteral("d"), QStringLiteral("e")}) {
+        items.append(itemForEmail(email));
+    }
+    model.addItems(items);
+    d->queueDownload(items.at(0), false, false);
+    d->queueDownload(items.at(1), false, false);
+    d->queueDownload(items.at(2), false, false);
+    d->queueDownload(items.at(3), false, true);
+    d->queueDownload(items.at(4), false, true);
+    // Prioritized after d and e, and only once
+    model.prioritizeDownload(items.at(2));
+    model.prioritizeDownload(items.at(2));
+    model.prioritizeDownload(items.at(3));
+    QCOMPARE(d->mQueuedDownloads.size(), 5);
+
+    d->startQueuedDownloads();
+    while (d->mRunningDownloads.size() > 0) {
+        model.slotInsertFreeBusy(KCalendarCore::FreeBusy::Ptr(), started.last());
+    }
+    QCOMPARE(started, QStringList({QStringLiteral("d"), QStringLiteral("e"), QStringLiteral("c"), QStringLiteral("a"), QStringLiteral("b")}));
+    QCOMPARE(d->mQueuedDownloads.size(), 0);
+}
+
+void FreeBusyItemModelTest::testDownloadTimeout()
+{
+    FreeBusyItemModel model;
+    FreeBusyItemModelPrivate *const d = FreeBusyItemModelPrivate::get(&model);
+    QStringList started;
+    d->mRetrieve = recordRetrievals(started);
+    model.setMaxConcurrentDownloads(1);
+
+    const FreeBusyItem::Ptr item1 = itemForEmail(QStringLiteral("a@example.com"));
+    const FreeBusyItem::Ptr item2 = itemForEmail(QStringLiteral("b@example.com"));
+    model.addItems({item1, item2});
+    d->queueDownload(item1, false, false);
+    d->queueDownload(item2, false, false);
+    d->startQueuedDownloads();
+    QCOMPARE(d->mRunningDownloads.size(), 1);
+
+    // Not timed out yet
+    d->expireDownloads();
+    QCOMPARE(d->mRunningDownloads.size(), 1);
+    QCOMPARE(d->mQueuedDownloads.size(), 1);
+
+    d->mDownloadTimeout = 0;
+    d->expireDownloads();
+    QCOMPARE(started, QStringList({QStringLiteral("a@example.com"), QStringLiteral("b@example.com")}));
+    QCOMPARE(d->mRunningDownloads.size(), 1);
+    QCOMPARE(d->mQueuedDownloads.size(), 0);
+    QVERIFY(!item1->isDownloading());
+    QVERIFY(item2->isDownloading());
+
+    // A late reply of the expired download changes nothing
+    model.slotInsertFreeBusy(KCalendarCore::FreeBusy::Ptr(), QStringLiteral("a@example.com"));
+    QCOMPARE(d->mRunningDownloads.size(), 1);
+    QVERIFY(item2->isDownloading());
+}
+
+void FreeBusyItemModelTest::testDownloadCachedReply()
+{
+    FreeBusyItemModel model;
+    FreeBusyItemModelPrivate *const d = FreeBusyItemModelPrivate::get(&model);
+    model.setMaxConcurrentDownloads(1);
+
+    KCalendarCore::FreeBusy::Ptr cached(new KCalendarCore::FreeBusy());
+    cached->addPeriod(QDateTime(QDate(2010, 7, 24), QTime(7, 0, 0), Qt::UTC), KCalendarCore::Duration(60 * 60));
+
+    // Like Akonadi for locally cached data, answer before the retrieval
+    // returns; no other reply follows
+    QStringList started;
+    d->mRetrieve = [&](const FreeBusyItem::Ptr &item, bool) {
+        started.append(item->email());
+        model.slotInsertFreeBusy(cached, item->email());
+        return true;
+    };
+
+    const FreeBusyItem::Ptr item1 = itemForEmail(QStringLiteral("a@example.com"));
+    const FreeBusyItem::Ptr item2 = itemForEmail(QStringLiteral("b@example.com"));
+    const FreeBusyItem::Ptr item3 = itemForEmail(QStringLiteral("c@example.com"));
+    model.addItems({item1, item2, item3});
+    d->queueDownload(item1, false, false);
+    d->queueDownload(item2, false, false);
+    d->queueDownload(item3, false, false);
+    d->startQueuedDownloads();
+
+    // Each answered download frees its slot as soon as it returns, so all
+    // of them run in one go
+    QCOMPARE(started, QStringList({QStringLiteral("a@example.com"), QStringLiteral("b@example.com"), QStringLiteral("c@example.com")}));
+    QCOMPARE(item1->freeBusy(), cached);
+    QCOMPARE(model.rowCount(model.index(0, 0)), 1);
+    QVERIFY(!item1->isDownloading());
+    QVERIFY(!item3->isDownloading());
+    QCOMPARE(d->mRunningDownloads.size(), 0);
+    QCOMPARE(d->mQueuedDownloads.size(), 0);
+    QVERIFY(!d->mDownloadTimeoutTimer.isActive());
+
+    // A retrieval that answers later keeps its slot until then
+    d->mRetrieve = recordRetrievals(started);
+    d->queueDownload(item1, false, false);
+    d->startQueuedDownloads();
+    QVERIFY(item1->isDownloading());
+    QCOMPARE(d->mRunningDownloads.size(), 1);
+
+    KCalendarCore::FreeBusy::Ptr retrieved(new KCalendarCore::FreeBusy());
+    retrieved->addPeriod(QDateTime(QDate(2010, 7, 24), QTime(9, 0, 0), Qt::UTC), KCalendarCore::Duration(60 * 60));
+    model.slotInsertFreeBusy(retrieved, QStringLiteral("a@example.com"));
+    QCOMPARE(item1->freeBusy(), retrieved);
+    QVERIFY(!item1->isDownloading());
+    QCOMPARE(d->mRunningDownloads.size(), 0);
+}
+
+void FreeBusyItemModelTest::testAddItems()
+{
+    auto model = new FreeBusyItemModel(this);
+    new QAbstractItemModelTester(model, this);
+
+    const QDateTime dt1(QDate(2010, 7, 24), QTime(7, 0, 0), Qt::UTC);
+    const QDateTime dt2(QDate(2010, 7, 24), QTime(10, 0, 0), Qt::UTC);
+    KCalendarCore::FreeBusy::Ptr fb1(new KCalendarCore::FreeBusy());
+    fb1->addPeriod(dt2, KCalendarCore::Duration(60 * 60));
+    fb1->addPeriod(dt1, KCalendarCore::Duration(60 * 60));
+
+    QList<FreeBusyItem::Ptr> items;
+    for (int i = 0; i < 3; ++i) {
+        const QString name = QStringLiteral("attendee%1").arg(i);
+        FreeBusyItem::Ptr item(new FreeBusyItem(KCalendarCore::Attendee(name, name + QStringLiteral("@example.com")), nullptr));
+        if (i == 1) {
+            item->setFreeBusy(fb1);
+        }
+        items.append(item);
+    }
+
+    QSignalSpy inserted(model, &QAbstractItemModel::rowsInserted);
+    model->addItems(items);
+    QCOMPARE(inserted.count(), 1);
+    QCOMPARE(inserted.at(0).at(1).toInt(), 0);
+    QCOMPARE(inserted.at(0).at(2).toInt(), 2);
+
+    QCOMPARE(model->rowCount(), 3);
+    QVERIFY(model->containsAttendee(items.at(2)->attendee()));
+    QCOMPARE(model->rowCount(model->index(0, 0)), 0);
+    const QModelIndex parent = model->index(1, 0);
+    QCOMPARE(model->rowCount(parent), 2);
+    QCOMPARE(model->data(model->index(0, 0, parent), FreeBusyItemModel::FreeBusyPeriodRole).value<KCalendarCore::FreeBusyPeriod>().start(), dt1);
+    for (const auto &item : std::as_const(items)) {
+        QVERIFY(FreeBusyItemModelPrivate::get(model)->hasPendingUpdate(item));
+    }
+    for (const auto &update : FreeBusyItemModelPrivate::get(model)->mPendingUpdates) {
+        QVERIFY(update.prioritized);
+    }
+}
+
 #include "moc_testfreebusyitemmodel.cpp"
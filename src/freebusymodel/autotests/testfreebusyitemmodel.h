@@ -18,5 +18,16 @@ private Q_SLOTS:
     void testModelValidity();
     void testModelValidity2();
     void testInsertFreeBusy();
+    void testLookupAfterRemoval();
+    void testPeriodsSorted();
+    void testMinimalPeriodUpdates();
+    void testUpdateScheduling();
+    void testMaxConcurrentDownloads();
+    void testDownloadCap();
+    void testDownloadSharedEmail();
+    void testDownloadPriority();
+    void testDownloadTimeout();
+    void testDownloadCachedReply();
+    void testAddItems();
 };
 }
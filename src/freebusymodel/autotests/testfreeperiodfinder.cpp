@@ -0,0 +1,149 @@
+/*
+  SPDX-FileCopyrightText: 2026 KDE PIM Authors
+
+  SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "testfreeperiodfinder.h"
+#include "../freebusyitem.h"
+#include "../freebusyitemmodel.h"
+#include "../freeperiodfinder.h"
+#include "../freeperiodmodel.h"
+
+#include <KCalendarCore/Attendee>
+
+#include <QRegularExpression>
+#include <QSignalSpy>
+#include <QTest>
+
+using namespace CalendarSupport;
+
+QTEST_GUILESS_MAIN(FreePeriodFinderTest)
+
+static QDateTime at(int day, int hour, int minute = 0)
+{
+    // 2010-07-26 is a Monday
+    return QDateTime(QDate(2010, 7, 26).addDays(day), QTime(hour, minute), Qt::UTC);
+}
+
+static KCalendarCore::FreeBusyPeriod busy(const QDateTime &start, const QDateTime &end)
+{
+    KCalendarCore::FreeBusyPeriod period(start, end);
+    period.setType(KCalendarCore::FreeBusyPeriod::Busy);
+    return period;
+}
+
+static KCalendarCore::Period::List periods(const QList<std::pair<QDateTime, QDateTime>> &ranges)
+{
+    KCalendarCore::Period::List list;
+    for (const auto &[start, end] : ranges) {
+        list.append(KCalendarCore::Period(start, end));
+    }
+    return list;
+}
+
+void FreePeriodFinderTest::testNoBusyPeriods()
+{
+    QCOMPARE(FreePeriodFinder::freePeriods({}, at(0, 8), at(0, 18)), periods({{at(0, 8), at(0, 18)}}));
+    QCOMPARE(FreePeriodFinder::freePeriods({{}, {}}, at(0, 8), at(0, 18)), periods({{at(0, 8), at(0, 18)}}));
+    QVERIFY(FreePeriodFinder::freePeriods({}, at(0, 18), at(0, 8)).isEmpty());
+}
+
+void FreePeriodFinderTest::testMergeAttendees()
+{
+    const QList<KCalendarCore::FreeBusyPeriod::List> busyPeriods = {
+        {busy(at(0, 7), at(0, 9)), busy(at(0, 12), at(0, 13))},
+        {busy(at(0, 8), at(0, 10)), busy(at(0, 15), at(0, 16)), busy(at(0, 20), at(0, 21))},
+        {busy(at(0, 9, 30), at(0, 11))},
+    };
+    QCOMPARE(FreePeriodFinder::freePeriods(busyPeriods, at(0, 8), at(0, 18)),
+             periods({{at(0, 11), at(0, 12)}, {at(0, 13), at(0, 15)}, {at(0, 16), at(0, 18)}}));
+}
+
+void FreePeriodFinderTest::testFreeTypeIgnored()
+{
+    KCalendarCore::FreeBusyPeriod free(at(0, 10), at(0, 12));
+    free.setType(KCalendarCore::FreeBusyPeriod::Free);
+    QCOMPARE(FreePeriodFinder::freePeriods({{free, busy(at(0, 14), at(0, 15))}}, at(0, 8), at(0, 18)),
+             periods({{at(0, 8), at(0, 14)}, {at(0, 15), at(0, 18)}}));
+}
+
+void FreePeriodFinderTest::testWorkingHours()
+{
+    // Monday to Friday, nine to five; the window spans a whole week
+    const QList<KCalendarCore::FreeBusyPeriod::List> busyPeriods = {
+        {busy(at(1, 8), at(1, 10)), busy(at(2, 16), at(3, 12))},
+    };
+    const auto found = FreePeriodFinder::freePeriods(busyPeriods, at(0, 0), at(7, 0), 0x1f, QTime(9, 0), QTime(17, 0));
+    QCOMPARE(found,
+             periods({{at(0, 9), at(0, 17)},
+                      {at(1, 10), at(1, 17)},
+                      {at(2, 9), at(2, 16)},
+                      {at(3, 12), at(3, 17)},
+                      {at(4, 9), at(4, 17)}}));
+
+    // Whole days only: the weekend is left out
+    QCOMPARE(FreePeriodFinder::freePeriods({}, at(4, 12), at(7, 12), 0x1f), periods({{at(4, 12), at(5, 0)}, {at(7, 0), at(7, 12)}}));
+}
+
+void FreePeriodFinderTest::testInvertedWorkingHours()
+{
+    // Night shifts from ten to six on Monday to Friday, each belonging to
+    // the day it starts on; the window starts on Monday morning
+    const QList<KCalendarCore::FreeBusyPeriod::List> busyPeriods = {{busy(at(0, 23), at(1, 1))}};
+    const KCalendarCore::Period::List nights = periods({{at(0, 22), at(0, 23)}, {at(1, 1), at(1, 6)}, {at(1, 22), at(2, 2)}});
+    QCOMPARE(FreePeriodFinder::freePeriods(busyPeriods, at(0, 0), at(2, 2), 0x1f, QTime(22, 0), QTime(6, 0)), nights);
+
+    // The shift of Sunday night covers Monday morning, the one of Friday
+    // night covers Saturday morning
+    QCOMPARE(FreePeriodFinder::freePeriods({}, at(-1, 12), at(0, 12), 0x7f, QTime(22, 0), QTime(6, 0)), periods({{at(-1, 22), at(0, 6)}}));
+    QCOMPARE(FreePeriodFinder::freePeriods({}, at(0, 0), at(0, 12), 0x1f, QTime(22, 0), QTime(6, 0)), KCalendarCore::Period::List());
+    QCOMPARE(FreePeriodFinder::freePeriods({}, at(5, 0), at(5, 12), 0x1f, QTime(22, 0), QTime(6, 0)), periods({{at(5, 0), at(5, 6)}}));
+
+    // Working hours without any time are rejected, not widened
+    QTest::ignoreMessage(QtWarningMsg, QRegularExpression(QStringLiteral("^Working hours start and end at the same time")));
+    QVERIFY(FreePeriodFinder::freePeriods(busyPeriods, at(0, 0), at(1, 0), 0x7f, QTime(9, 0), QTime(9, 0)).isEmpty());
+
+    FreeBusyItemModel model;
+    FreeBusyItem::Ptr item(new FreeBusyItem(KCalendarCore::Attendee(QStringLiteral("fred"), QStringLiteral("fred@example.com")), nullptr));
+    KCalendarCore::FreeBusy::Ptr fb(new KCalendarCore::FreeBusy(busyPeriods.first()));
+    item->setFreeBusy(fb);
+    model.addItem(item);
+
+    FreePeriodFinder finder;
+    finder.setModel(&model);
+    finder.setSearchWindow(at(0, 0), at(2, 2));
+    finder.setWorkingHours(0x1f, QTime(22, 0), QTime(6, 0));
+    QSignalSpy found(&finder, &FreePeriodFinder::freePeriodsFound);
+    finder.search();
+    QCOMPARE(found.count(), 1);
+    QCOMPARE(found.at(0).at(0).value<KCalendarCore::Period::List>(), nights);
+}
+
+void FreePeriodFinderTest::testSearchModel()
+{
+    FreeBusyItemModel model;
+    KCalendarCore::FreeBusy::Ptr fb1(new KCalendarCore::FreeBusy());
+    fb1->addPeriod(at(0, 10), at(0, 11));
+    KCalendarCore::FreeBusy::Ptr fb2(new KCalendarCore::FreeBusy());
+    fb2->addPeriod(at(0, 14), at(0, 15));
+    FreeBusyItem::Ptr item1(new FreeBusyItem(KCalendarCore::Attendee(QStringLiteral("fred"), QStringLiteral("fred@example.com")), nullptr));
+    item1->setFreeBusy(fb1);
+    FreeBusyItem::Ptr item2(new FreeBusyItem(KCalendarCore::Attendee(QStringLiteral("joe"), QStringLiteral("joe@example.com")), nullptr));
+    item2->setFreeBusy(fb2);
+    model.addItems({item1, item2});
+
+    FreePeriodFinder finder;
+    finder.setModel(&model);
+    finder.setSearchWindow(at(0, 9), at(0, 17));
+    FreePeriodModel periodModel;
+    connect(&finder, &FreePeriodFinder::freePeriodsFound, &periodModel, &FreePeriodModel::slotNewFreePeriods);
+    QSignalSpy found(&finder, &FreePeriodFinder::freePeriodsFound);
+
+    finder.search();
+    QCOMPARE(found.count(), 1);
+    QCOMPARE(found.at(0).at(0).value<KCalendarCore::Period::List>(), periods({{at(0, 9), at(0, 10)}, {at(0, 11), at(0, 14)}, {at(0, 15), at(0, 17)}}));
+    QCOMPARE(periodModel.rowCount(), 3);
+}
+
+#include "moc_testfreeperiodfinder.cpp"
@@ -0,0 +1,24 @@
+/*
+  SPDX-FileCopyrightText: 2026 KDE PIM Authors
+
+  SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <QObject>
+
+namespace CalendarSupport
+{
+class FreePeriodFinderTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testNoBusyPeriods();
+    void testMergeAttendees();
+    void testFreeTypeIgnored();
+    void testWorkingHours();
+    void testInvertedWorkingHours();
+    void testSearchModel();
+};
+}
@@ -12,7 +12,9 @@
 #include <KCalendarCore/Period>
 
 #include <QAbstractItemModelTester>
+#include <QSignalSpy>
 #include <QTest>
+#include <QTimeZone>
 
 using namespace CalendarSupport;
 
@@ -72,4 +74,196 @@ void FreePeriodModelTest::testSplitByDay()
     QCOMPARE(period2.end(), endDt);
 }
 
+void FreePeriodModelTest::testSplitAcrossDays()
+{
+    auto model = new FreePeriodModel(this);
+    new QAbstractItemModelTester(model, this);
+
+    const QTimeZone zone(2 * 60 * 60);
+    const auto at = [&zone](int day, const QTime &time) {
+        return QDateTime(QDate(2010, 7, day), time, zone);
+    };
+
+    KCalendarCore::Period::List list;
+    // From 10pm on the 24th to 00:03 on the 27th, in UTC+2
+    list << KCalendarCore::Period(at(24, QTime(22, 0)), at(27, QTime(0, 3)));
+    // Unsorted and duplicated same day periods
+    list << KCalendarCore::Period(at(24, QTime(10, 0)), at(24, QTime(11, 0)));
+    list << KCalendarCore::Period(at(24, QTime(10, 0)), at(24, QTime(11, 0)));
+
+    model->slotNewFreePeriods(list);
+
+    // The three minutes on the 27th are too short to be kept
+    const QList<std::pair<QDateTime, QDateTime>> expected = {
+        {at(24, QTime(10, 0)), at(24, QTime(11, 0))},
+        {at(24, QTime(22, 0)), at(24, QTime(23, 59, 59, 999))},
+        {at(25, QTime(0, 0)), at(25, QTime(23, 59, 59, 999))},
+        {at(26, QTime(0, 0)), at(26, QTime(23, 59, 59, 999))},
+    };
+    QCOMPARE(model->rowCount(), expected.size());
+    for (int row = 0; row < expected.size(); ++row) {
+        const auto period = model->data(model->index(row, 0), FreePeriodModel::PeriodRole).value<KCalendarCore::Period>();
+        QCOMPARE(period.start(), expected.at(row).first);
+        QCOMPARE(period.end(), expected.at(row).second);
+    }
+}
+
+void FreePeriodModelTest::testSplitAcrossOffsetChange()
+{
+    // Pyongyang moved from UTC+8:30 to UTC+9 at midnight of 2018-05-05,
+    // without daylight saving time
+    const QTimeZone zone("Asia/Pyongyang");
+    if (!zone.isValid()) {
+        QSKIP("Asia/Pyongyang is not available");
+    }
+    auto model = new FreePeriodModel(this);
+    const QDateTime start(QDate(2018, 5, 4), QTime(12, 0), zone);
+    const QDateTime end(QDate(2018, 5, 5), QTime(12, 0), zone);
+    model->slotNewFreePeriods({KCalendarCore::Period(start, end)});
+
+    const QDateTime midnight = QDate(2018, 5, 5).startOfDay(zone);
+    QCOMPARE(model->rowCount(), 2);
+    const auto period1 = model->data(model->index(0, 0), FreePeriodModel::PeriodRole).value<KCalendarCore::Period>();
+    const auto period2 = model->data(model->index(1, 0), FreePeriodModel::PeriodRole).value<KCalendarCore::Period>();
+    QCOMPARE(period1.start(), start);
+    QCOMPARE(period1.end(), midnight.addMSecs(-1));
+    QCOMPARE(period2.start(), midnight);
+    QCOMPARE(period2.end(), end);
+    QCOMPARE(period2.start().toTimeZone(zone).date(), QDate(2018, 5, 5));
+    QCOMPARE(period1.end().toTimeZone(zone).date(), QDate(2018, 5, 4));
+}
+
+void FreePeriodModelTest::testIncrementalUpdate()
+{
+    auto model = new FreePeriodModel(this);
+    new QAbstractItemModelTester(model, this);
+
+    const auto at = [](int hour) {
+        return QDateTime(QDate(2010, 7, 24), QTime(hour, 0, 0), Qt::UTC);
+    };
+    const auto periods = [&at](const QList<int> &hours) {
+        KCalendarCore::Period::List list;
+        for (const int hour : hours) {
+            list << KCalendarCore::Period(at(hour), at(hour + 1));
+        }
+        return list;
+    };
+
+    model->slotNewFreePeriods(periods({8, 10, 12}));
+    QCOMPARE(model->rowCount(), 3);
+
+    QSignalSpy reset(model, &QAbstractItemModel::modelReset);
+    QSignalSpy inserted(model, &QAbstractItemModel::rowsInserted);
+    QSignalSpy removed(model, &QAbstractItemModel::rowsRemoved);
+    QSignalSpy changed(model, &QAbstractItemModel::dataChanged);
+
+    // The same periods, in a different order
+    model->slotNewFreePeriods(periods({12, 8, 10}));
+    QCOMPARE(inserted.count() + removed.count() + changed.count(), 0);
+
+    // 8 went away and 14 is new
+    model->slotNewFreePeriods(periods({10, 12, 14}));
+    QCOMPARE(reset.count(), 0);
+    QCOMPARE(removed.count(), 1);
+    QCOMPARE(removed.at(0).at(1).toInt(), 0);
+    QCOMPARE(removed.at(0).at(2).toInt(), 0);
+    QCOMPARE(inserted.count(), 1);
+    QCOMPARE(inserted.at(0).at(1).toInt(), 2);
+    QCOMPARE(changed.count(), 0);
+
+    // 12 got longer
+    KCalendarCore::Period::List list = periods({10, 14});
+    list << KCalendarCore::Period(at(12), at(13).addSecs(30 * 60));
+    model->slotNewFreePeriods(list);
+    QCOMPARE(changed.count(), 1);
+    QCOMPARE(changed.at(0).at(0).toModelIndex().row(), 1);
+    QCOMPARE(model->rowCount(), 3);
+    QCOMPARE(model->data(model->index(1, 0), FreePeriodModel::PeriodRole).value<KCalendarCore::Period>().end(), at(13).addSecs(30 * 60));
+
+    // 10 comes in another time zone: same time, different text
+    const QTimeZone zone(2 * 60 * 60);
+    const QString oldText = model->data(model->index(0, 1)).toString();
+    list[0] = KCalendarCore::Period(at(10).toTimeZone(zone), at(11).toTimeZone(zone));
+    model->slotNewFreePeriods(list);
+    QCOMPARE(changed.count(), 2);
+    QCOMPARE(changed.at(1).at(0).toModelIndex().row(), 0);
+    QCOMPARE(changed.at(1).at(1).toModelIndex().column(), 1);
+    QCOMPARE(model->data(model->index(0, 0), FreePeriodModel::PeriodRole).value<KCalendarCore::Period>().start().timeZone(), zone);
+    QVERIFY(model->data(model->index(0, 1)).toString() != oldText);
+}
+
+void FreePeriodModelTest::testDisplayStringsFollowLocale()
+{
+    const QLocale defaultLocale;
+    QLocale::setDefault(QLocale(QLocale::English, QLocale::UnitedStates));
+
+    auto model = new FreePeriodModel(this);
+    const QDateTime dt1(QDate(2010, 7, 24), QTime(7, 0, 0), Qt::UTC);
+    model->slotNewFreePeriods({KCalendarCore::Period(dt1, KCalendarCore::Duration(60 * 60))});
+
+    const QModelIndex index = model->index(0, 1);
+    const QString toolTip = model->data(index, Qt::ToolTipRole).toString();
+    QVERIFY(toolTip.contains(QLocale().toString(dt1.toLocalTime(), QLocale::ShortFormat)));
+    QCOMPARE(model->data(index, Qt::ToolTipRole).toString(), toolTip);
+    QVERIFY(!model->data(index, Qt::DisplayRole).toString().isEmpty());
+
+    // Formatted once, until the view asks for them to be formatted again
+    QLocale::setDefault(QLocale(QLocale::German, QLocale::Germany));
+    QCOMPARE(model->data(index, Qt::ToolTipRole).toString(), toolTip);
+    model->refreshDisplayStrings();
+    const QString germanToolTip = model->data(index, Qt::ToolTipRole).toString();
+    QVERIFY(germanToolTip != toolTip);
+    QVERIFY(germanToolTip.contains(QLocale().toString(dt1.toLocalTime(), QLocale::ShortFormat)));
+
+    QLocale::setDefault(defaultLocale);
+}
+
+void FreePeriodModelTest::testDisplayStringsFollowLanguage()
+{
+    auto model = new FreePeriodModel(this);
+    const QDateTime dt1(QDate(2010, 7, 24), QTime(7, 0, 0), Qt::UTC);
+    model->slotNewFreePeriods({KCalendarCore::Period(dt1, KCalendarCore::Duration(60 * 60))});
+    QVERIFY(!model->data(model->index(0, 1), Qt::ToolTipRole).toString().isEmpty());
+
+    // Views refresh all strings on a language change, like the ones of their
+    // own widgets
+    QSignalSpy changed(model, &QAbstractItemModel::dataChanged);
+    model->refreshDisplayStrings();
+    QCOMPARE(changed.count(), 1);
+    QCOMPARE(changed.at(0).at(0).toModelIndex(), model->index(0, 0));
+    QCOMPARE(changed.at(0).at(1).toModelIndex(), model->index(0, 1));
+    QVERIFY(!model->data(model->index(0, 1), Qt::ToolTipRole).toString().isEmpty());
+
+    // Also without rows
+    auto empty = new FreePeriodModel(this);
+    QSignalSpy emptyChanged(empty, &QAbstractItemModel::dataChanged);
+    empty->refreshDisplayStrings();
+    QCOMPARE(emptyChanged.count(), 0);
+}
+
+void FreePeriodModelTest::testDisplayStringsFollowTimeZone()
+{
+    const QByteArray oldTimeZone = qgetenv("TZ");
+    qputenv("TZ", "UTC");
+
+    auto model = new FreePeriodModel(this);
+    const QDateTime dt1(QDate(2010, 7, 24), QTime(7, 0, 0), Qt::UTC);
+    model->slotNewFreePeriods({KCalendarCore::Period(dt1, KCalendarCore::Duration(60 * 60))});
+    const QString toolTip = model->data(model->index(0, 1), Qt::ToolTipRole).toString();
+    QVERIFY(toolTip.contains(QLocale().toString(dt1.toLocalTime(), QLocale::ShortFormat)));
+
+    // The tool tips show local time
+    qputenv("TZ", "Asia/Tokyo");
+    model->refreshDisplayStrings();
+    const QString tokyoToolTip = model->data(model->index(0, 1), Qt::ToolTipRole).toString();
+    QVERIFY(tokyoToolTip != toolTip);
+    QVERIFY(tokyoToolTip.contains(QLocale().toString(dt1.toLocalTime(), QLocale::ShortFormat)));
+
+    if (oldTimeZone.isNull()) {
+        qunsetenv("TZ");
+    } else {
+        qputenv("TZ", oldTimeZone);
+    }
+}
+
 #include "moc_testfreeperiodmodel.cpp"
@@ -17,5 +17,11 @@ class FreePeriodModelTest : public QObject
 private Q_SLOTS:
     void testModelValidity();
     void testSplitByDay();
+    void testSplitAcrossDays();
+    void testSplitAcrossOffsetChange();
+    void testIncrementalUpdate();
+    void testDisplayStringsFollowLocale();
+    void testDisplayStringsFollowLanguage();
+    void testDisplayStringsFollowTimeZone();
 };
 }
@@ -0,0 +1,202 @@
+/*
+  SPDX-FileCopyrightText: 2026 KDE PIM Authors
+
+  SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "busyhistogram.h"
+#include "freebusyitemmodel.h"
+
+#include <algorithm>
+#include <array>
+
+using namespace CalendarSupport;
+
+namespace
+{
+const int typeCount = KCalendarCore::FreeBusyPeriod::Unknown + 1;
+
+// Adds one attendee after another to difference arrays of the slot counts.
+// Overlapping slot ranges of the same attendee are merged first, so that
+// every attendee counts once per slot.
+class DifferenceArrays
+{
+public:
+    DifferenceArrays(qint64 startMSecs, qint64 slotMSecs, int slotCount, bool byType)
+        : mStartMSecs(startMSecs)
+        , mSlotMSecs(slotMSecs)
+        , mSlotCount(slotCount)
+        , mTotal(slotCount + 1, 0)
+    {
+        if (byType) {
+            mByType.fill(0, qsizetype(typeCount) * (slotCount + 1));
+        }
+    }
+
+    void addAttendee(const KCalendarCore::FreeBusyPeriod::List &periods)
+    {
+        // The periods are sorted by start, so are their slot ranges, and a
+        // range can only overlap the last one kept
+        Range total;
+        std::array<Range, typeCount> byType;
+        for (const KCalendarCore::FreeBusyPeriod &period : periods) {
+            const qint64 from = period.start().toMSecsSinceEpoch() - mStartMSecs;
+            const qint64 to = period.end().toMSecsSinceEpoch() - mStartMSecs;
+            if (to <= 0 || from >= mSlotCount * mSlotMSecs || from >= to) {
+                continue;
+            }
+            const Range range{from <= 0 ? 0 : int(from / mSlotMSecs), int(std::min<qint64>(mSlotCount - 1, (to - 1) / mSlotMSecs))};
+
+            const int type = std::clamp(int(period.type()), 0, typeCount - 1);
+            if (type != KCalendarCore::FreeBusyPeriod::Free) {
+                merge(total, range, mTotal.data());
+            }
+            if (!mByType.isEmpty()) {
+                merge(byType[type], range, typeDifferences(type));
+            }
+        }
+
+        add(total, mTotal.data());
+        if (!mByType.isEmpty()) {
+            for (int type = 0; type < typeCount; ++type) {
+                add(byType[type], typeDifferences(type));
+            }
+        }
+    }
+
+    // Turns the differences into counts by prefix sums
+    [[nodiscard]] QList<int> counts(const QList<int> &differences) const
+    {
+        QList<int> counts;
+        const qsizetype arrays = differences.size() / (mSlotCount + 1);
+        counts.reserve(arrays * mSlotCount);
+        for (qsizetype array = 0; array < arrays; ++array) {
+            int count = 0;
+            const int *values = differences.constData() + array * (mSlotCount + 1);
+            for (int slot = 0; slot < mSlotCount; ++slot) {
+                count += values[slot];
+                counts.append(count);
+            }
+        }
+        return counts;
+    }
+
+    [[nodiscard]] const QList<int> &total() const
+    {
+        return mTotal;
+    }
+
+    [[nodiscard]] const QList<int> &byType() const
+    {
+        return mByType;
+    }
+
+private:
+    struct Range {
+        int first = -1;
+        int last = -1;
+    };
+
+    int *typeDifferences(int type)
+    {
+        return mByType.data() + qsizetype(type) * (mSlotCount + 1);
+    }
+
+    static void merge(Range &pending, const Range &range, int *differences)
+    {
+        if (pending.first >= 0 && range.first <= pending.last + 1) {
+            pending.last = std::max(pending.last, range.last);
+            return;
+        }
+        add(pending, differences);
+        pending = range;
+    }
+
+    static void add(const Range &range, int *differences)
+    {
+        if (range.first >= 0) {
+            ++differences[range.first];
+            --differences[range.last + 1];
+        }
+    }
+
+    const qint64 mStartMSecs;
+    const qint64 mSlotMSecs;
+    const int mSlotCount;
+    QList<int> mTotal;
+    QList<int> mByType;
+};
+}
+
+BusyHistogram
+BusyHistogram::fromModel(const FreeBusyItemModel *model, const QDateTime &start, const QDateTime &end, int slotMinutes, bool byType)
+{
+    QList<KCalendarCore::FreeBusyPeriod::List> busyPeriods;
+    const int count = model->rowCount();
+    busyPeriods.reserve(count);
+    for (int row = 0; row < count; ++row) {
+        busyPeriods.append(model->busyPeriods(row));
+    }
+    return fromBusyPeriods(busyPeriods, start, end, slotMinutes, byType);
+}
+
+BusyHistogram BusyHistogram::fromBusyPeriods(const QList<KCalendarCore::FreeBusyPeriod::List> &busyPeriods,
+                                             const QDateTime &start,
+                                             const QDateTime &end,
+                                             int slotMinutes,
+                                             bool byType)
+{
+    BusyHistogram histogram;
+    if (!start.isValid() || !end.isValid() || start >= end || slotMinutes <= 0) {
+        return histogram;
+    }
+    histogram.mStart = start;
+    histogram.mSlotMSecs = qint64(slotMinutes) * 60 * 1000;
+    histogram.mSlotCount = int((end.toMSecsSinceEpoch() - start.toMSecsSinceEpoch()) / histogram.mSlotMSecs);
+
+    DifferenceArrays differences(start.toMSecsSinceEpoch(), histogram.mSlotMSecs, histogram.mSlotCount, byType);
+    for (const KCalendarCore::FreeBusyPeriod::List &periods : busyPeriods) {
+        differences.addAttendee(periods);
+    }
+    histogram.mCounts = differences.counts(differences.total());
+    histogram.mTypeCounts = differences.counts(differences.byType());
+    return histogram;
+}
+
+bool BusyHistogram::isValid() const
+{
+    return mSlotCount > 0;
+}
+
+int BusyHistogram::slotCount() const
+{
+    return mSlotCount;
+}
+
+QDateTime BusyHistogram::slotStart(int slot) const
+{
+    return mStart.addMSecs(slot * mSlotMSecs);
+}
+
+int BusyHistogram::busyCount(int slot) const
+{
+    return mCounts.value(slot);
+}
+
+int BusyHistogram::busyCount(int slot, KCalendarCore::FreeBusyPeriod::FreeBusyType type) const
+{
+    if (mTypeCounts.isEmpty() || slot < 0 || slot >= mSlotCount) {
+        return 0;
+    }
+    return mTypeCounts.value(qsizetype(type) * mSlotCount + slot);
+}
+
+QList<int> BusyHistogram::busyCounts() const
+{
+    return mCounts;
+}
+
+int BusyHistogram::maximumBusyCount() const
+{
+    return mCounts.isEmpty() ? 0 : *std::max_element(mCounts.cbegin(), mCounts.cend());
+}
@@ -0,0 +1,82 @@
+/*
+  SPDX-FileCopyrightText: 2026 KDE PIM Authors
+
+  SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "calendarsupport_export.h"
+
+#include <KCalendarCore/FreeBusyPeriod>
+
+#include <QDateTime>
+#include <QList>
+
+namespace CalendarSupport
+{
+class FreeBusyItemModel;
+
+/**
+ * A BusyHistogram counts for each slot of a time window how many
+ * attendees are busy in it, and optionally how many have a period of each
+ * FreeBusyPeriod::FreeBusyType in it.
+ *
+ * Every attendee is counted at most once per slot, also if several of
+ * their periods overlap it. Building the histogram costs time linear in
+ * the number of periods and slots.
+ */
+class CALENDARSUPPORT_EXPORT BusyHistogram
+{
+public:
+    BusyHistogram() = default;
+
+    /**
+     * Counts the busy attendees of @p model in slots of @p slotMinutes
+     * minutes from @p start up to @p end. If @p byType is true, the counts
+     * per period type are computed as well.
+     */
+    [[nodiscard]] static BusyHistogram
+    fromModel(const FreeBusyItemModel *model, const QDateTime &start, const QDateTime &end, int slotMinutes, bool byType = false);
+
+    /**
+     * Same as fromModel(), for one sorted busy period list per attendee.
+     */
+    [[nodiscard]] static BusyHistogram fromBusyPeriods(const QList<KCalendarCore::FreeBusyPeriod::List> &busyPeriods,
+                                                       const QDateTime &start,
+                                                       const QDateTime &end,
+                                                       int slotMinutes,
+                                                       bool byType = false);
+
+    [[nodiscard]] bool isValid() const;
+    [[nodiscard]] int slotCount() const;
+    [[nodiscard]] QDateTime slotStart(int slot) const;
+
+    /**
+     * Returns the number of attendees with a period other than
+     * FreeBusyPeriod::Free in @p slot.
+     */
+    [[nodiscard]] int busyCount(int slot) const;
+
+    /**
+     * Returns the number of attendees with a period of @p type in @p slot,
+     * or 0 if the histogram was built without counts per type.
+     */
+    [[nodiscard]] int busyCount(int slot, KCalendarCore::FreeBusyPeriod::FreeBusyType type) const;
+
+    /**
+     * Returns the busy count of every slot.
+     */
+    [[nodiscard]] QList<int> busyCounts() const;
+
+    [[nodiscard]] int maximumBusyCount() const;
+
+private:
+    QDateTime mStart;
+    qint64 mSlotMSecs = 0;
+    int mSlotCount = 0;
+    QList<int> mCounts;
+    // slotCount() counts for each type, type by type
+    QList<int> mTypeCounts;
+};
+}
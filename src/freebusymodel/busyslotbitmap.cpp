@@ -0,0 +1,214 @@
+/*
+  SPDX-FileCopyrightText: 2026 KDE PIM Authors
+
+  SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "busyslotbitmap.h"
+#include "freebusyitemmodel.h"
+
+#include <QtAlgorithms>
+
+#include <algorithm>
+
+using namespace CalendarSupport;
+
+BusySlotBitmap::BusySlotBitmap(const QDateTime &start, const QDateTime &end, int slotMinutes)
+{
+    if (!start.isValid() || !end.isValid() || start >= end || slotMinutes <= 0) {
+        return;
+    }
+    mStart = start;
+    mStartMSecs = start.toMSecsSinceEpoch();
+    mSlotMSecs = qint64(slotMinutes) * 60 * 1000;
+    mSlotCount = int((end.toMSecsSinceEpoch() - mStartMSecs) / mSlotMSecs);
+    mWords.fill(0, (mSlotCount + 63) / 64);
+}
+
+BusySlotBitmap
+BusySlotBitmap::fromBusyPeriods(const KCalendarCore::FreeBusyPeriod::List &periods, const QDateTime &start, const QDateTime &end, int slotMinutes)
+{
+    BusySlotBitmap bitmap(start, end, slotMinutes);
+    for (const KCalendarCore::FreeBusyPeriod &period : periods) {
+        if (period.type() != KCalendarCore::FreeBusyPeriod::Free) {
+            bitmap.markBusy(period.start(), period.end());
+        }
+    }
+    return bitmap;
+}
+
+BusySlotBitmap BusySlotBitmap::fromModel(const FreeBusyItemModel *model, const QDateTime &start, const QDateTime &end, int slotMinutes)
+{
+    // All periods go into one bitmap directly, that is the same as the union
+    // of one bitmap per attendee
+    BusySlotBitmap bitmap(start, end, slotMinutes);
+    const int count = model->rowCount();
+    for (int row = 0; row < count; ++row) {
+        const KCalendarCore::FreeBusyPeriod::List periods = model->busyPeriods(row);
+        for (const KCalendarCore::FreeBusyPeriod &period : periods) {
+            if (period.type() != KCalendarCore::FreeBusyPeriod::Free) {
+                bitmap.markBusy(period.start(), period.end());
+            }
+        }
+    }
+    return bitmap;
+}
+
+bool BusySlotBitmap::isValid() const
+{
+    return mSlotCount > 0;
+}
+
+int BusySlotBitmap::slotCount() const
+{
+    return mSlotCount;
+}
+
+int BusySlotBitmap::slotMinutes() const
+{
+    return int(mSlotMSecs / (60 * 1000));
+}
+
+QDateTime BusySlotBitmap::start() const
+{
+    return mStart;
+}
+
+QDateTime BusySlotBitmap::slotStart(int slot) const
+{
+    return mStart.addMSecs(slot * mSlotMSecs);
+}
+
+bool BusySlotBitmap::isBusy(int slot) const
+{
+    Q_ASSERT(slot >= 0 && slot < mSlotCount);
+    return mWords.at(slot / 64) & (quint64(1) << (slot % 64));
+}
+
+void BusySlotBitmap::setBusy(int slot, bool busy)
+{
+    Q_ASSERT(slot >= 0 && slot < mSlotCount);
+    const quint64 bit = quint64(1) << (slot % 64);
+    if (busy) {
+        mWords[slot / 64] |= bit;
+    } else {
+        mWords[slot / 64] &= ~bit;
+    }
+}
+
+void BusySlotBitmap::markBusy(const QDateTime &start, const QDateTime &end)
+{
+    if (!isValid()) {
+        return;
+    }
+    const qint64 from = start.toMSecsSinceEpoch() - mStartMSecs;
+    const qint64 to = end.toMSecsSinceEpoch() - mStartMSecs;
+    if (to <= 0 || from >= mSlotCount * mSlotMSecs || from >= to) {
+        return;
+    }
+    // The slots the period touches, also those it covers only partly
+    const int first = from <= 0 ? 0 : int(from / mSlotMSecs);
+    const int last = std::min<qint64>(mSlotCount - 1, (to - 1) / mSlotMSecs);
+    setRange(first, last);
+}
+
+void BusySlotBitmap::setRange(int first, int last)
+{
+    const int firstWord = first / 64;
+    const int lastWord = last / 64;
+    const quint64 firstMask = ~quint64(0) << (first % 64);
+    const quint64 lastMask = ~quint64(0) >> (63 - last % 64);
+    quint64 *words = mWords.data();
+    if (firstWord == lastWord) {
+        words[firstWord] |= firstMask & lastMask;
+        return;
+    }
+    words[firstWord] |= firstMask;
+    for (int i = firstWord + 1; i < lastWord; ++i) {
+        words[i] = ~quint64(0);
+    }
+    words[lastWord] |= lastMask;
+}
+
+void BusySlotBitmap::clearTail()
+{
+    if (mSlotCount % 64) {
+        mWords.last() &= ~quint64(0) >> (64 - mSlotCount % 64);
+    }
+}
+
+int BusySlotBitmap::busyCount() const
+{
+    int count = 0;
+    for (const quint64 word : mWords) {
+        count += qPopulationCount(word);
+    }
+    return count;
+}
+
+BusySlotBitmap &BusySlotBitmap::operator|=(const BusySlotBitmap &other)
+{
+    Q_ASSERT(mSlotCount == other.mSlotCount);
+    quint64 *words = mWords.data();
+    const quint64 *otherWords = other.mWords.constData();
+    const qsizetype count = std::min(mWords.size(), other.mWords.size());
+    for (qsizetype i = 0; i < count; ++i) {
+        words[i] |= otherWords[i];
+    }
+    return *this;
+}
+
+BusySlotBitmap &BusySlotBitmap::operator&=(const BusySlotBitmap &other)
+{
+    Q_ASSERT(mSlotCount == other.mSlotCount);
+    quint64 *words = mWords.data();
+    const quint64 *otherWords = other.mWords.constData();
+    const qsizetype count = std::min(mWords.size(), other.mWords.size());
+    for (qsizetype i = 0; i < count; ++i) {
+        words[i] &= otherWords[i];
+    }
+    return *this;
+}
+
+BusySlotBitmap BusySlotBitmap::operator~() const
+{
+    BusySlotBitmap bitmap = *this;
+    quint64 *words = bitmap.mWords.data();
+    for (qsizetype i = 0; i < bitmap.mWords.size(); ++i) {
+        words[i] = ~words[i];
+    }
+    bitmap.clearTail();
+    return bitmap;
+}
+
+int BusySlotBitmap::nextSlot(int from, bool busy) const
+{
+    // Skips whole words without a matching slot
+    for (int wordIndex = from / 64; from < mSlotCount; ++wordIndex, from = wordIndex * 64) {
+        quint64 word = busy ? mWords.at(wordIndex) : ~mWords.at(wordIndex);
+        word &= ~quint64(0) << (from % 64);
+        if (word) {
+            return std::min(mSlotCount, wordIndex * 64 + int(qCountTrailingZeroBits(word)));
+        }
+    }
+    return mSlotCount;
+}
+
+KCalendarCore::Period::List BusySlotBitmap::findFreeSlots(int slotsNeeded, int maxResults) const
+{
+    KCalendarCore::Period::List found;
+    if (slotsNeeded <= 0 || maxResults <= 0) {
+        return found;
+    }
+
+    int slot = 0;
+    while (slot < mSlotCount && found.size() < maxResults) {
+        const int runStart = nextSlot(slot, false);
+        const int runEnd = nextSlot(runStart, true);
+        for (int start = runStart; start + slotsNeeded <= runEnd && found.size() < maxResults; ++start) {
+            found.append(KCalendarCore::Period(slotStart(start), slotStart(start + slotsNeeded)));
+        }
+        slot = runEnd;
+    }
+    return found;
+}
@@ -0,0 +1,102 @@
+/*
+  SPDX-FileCopyrightText: 2026 KDE PIM Authors
+
+  SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "calendarsupport_export.h"
+
+#include <KCalendarCore/FreeBusyPeriod>
+#include <KCalendarCore/Period>
+
+#include <QDateTime>
+#include <QList>
+
+namespace CalendarSupport
+{
+class FreeBusyItemModel;
+
+/**
+ * A BusySlotBitmap divides a time window into slots of equal length and
+ * stores one bit per slot, set if the slot is busy.
+ *
+ * Combining the bitmaps of several attendees is a bitwise operation over
+ * 64 slots at a time: the union of busy time is |=, and a mask of allowed
+ * slots, e.g. working hours, is applied with &=.
+ */
+class CALENDARSUPPORT_EXPORT BusySlotBitmap
+{
+public:
+    BusySlotBitmap() = default;
+
+    /**
+     * Creates a bitmap without busy slots covering @p start up to @p end,
+     * in slots of @p slotMinutes minutes. A last slot that would reach past
+     * @p end is left out.
+     */
+    BusySlotBitmap(const QDateTime &start, const QDateTime &end, int slotMinutes);
+
+    /**
+     * Creates a bitmap in which every slot overlapping one of @p periods is
+     * busy. Periods of type FreeBusyPeriod::Free are ignored.
+     */
+    [[nodiscard]] static BusySlotBitmap
+    fromBusyPeriods(const KCalendarCore::FreeBusyPeriod::List &periods, const QDateTime &start, const QDateTime &end, int slotMinutes);
+
+    /**
+     * Creates a bitmap in which a slot is busy if any attendee of @p model
+     * is busy in it.
+     */
+    [[nodiscard]] static BusySlotBitmap fromModel(const FreeBusyItemModel *model, const QDateTime &start, const QDateTime &end, int slotMinutes);
+
+    [[nodiscard]] bool isValid() const;
+    [[nodiscard]] int slotCount() const;
+    [[nodiscard]] int slotMinutes() const;
+    [[nodiscard]] QDateTime start() const;
+    [[nodiscard]] QDateTime slotStart(int slot) const;
+
+    [[nodiscard]] bool isBusy(int slot) const;
+    void setBusy(int slot, bool busy = true);
+
+    /**
+     * Marks every slot overlapping @p start up to @p end as busy.
+     */
+    void markBusy(const QDateTime &start, const QDateTime &end);
+
+    /**
+     * Returns the number of busy slots.
+     */
+    [[nodiscard]] int busyCount() const;
+
+    /**
+     * Combines this bitmap with @p other, which must cover the same slots.
+     */
+    BusySlotBitmap &operator|=(const BusySlotBitmap &other);
+    BusySlotBitmap &operator&=(const BusySlotBitmap &other);
+
+    /**
+     * Returns the bitmap with every slot flipped, e.g. free slots as set
+     * bits.
+     */
+    [[nodiscard]] BusySlotBitmap operator~() const;
+
+    /**
+     * Returns the first @p maxResults periods of @p slotsNeeded consecutive
+     * free slots, one for each slot such a period can start at.
+     */
+    [[nodiscard]] KCalendarCore::Period::List findFreeSlots(int slotsNeeded, int maxResults) const;
+
+private:
+    [[nodiscard]] int nextSlot(int from, bool busy) const;
+    void setRange(int first, int last);
+    void clearTail();
+
+    QDateTime mStart;
+    qint64 mStartMSecs = 0;
+    qint64 mSlotMSecs = 0;
+    int mSlotCount = 0;
+    QList<quint64> mWords;
+};
+}
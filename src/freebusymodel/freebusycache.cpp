@@ -0,0 +1,256 @@
+/*
+  SPDX-FileCopyrightText: 2026 KDE PIM Authors
+
+  SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "freebusycache.h"
+#include "calendarsupport_debug.h"
+
+#include <KCalendarCore/FreeBusyPeriod>
+
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QPointer>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QTimer>
+
+using namespace CalendarSupport;
+
+// Bump the version when the layout of the file changes; older files are
+// then ignored.
+static const quint32 cacheMagic = 0x46424331; // "FBC1"
+static const quint32 cacheVersion = 2;
+
+class CalendarSupport::FreeBusyCachePrivate
+{
+public:
+    struct Entry {
+        QDateTime fetchTime;
+        KCalendarCore::FreeBusy::Ptr freeBusy;
+    };
+
+    static QString normalizedEmail(const QString &email)
+    {
+        return email.trimmed().toLower();
+    }
+
+    [[nodiscard]] bool isExpired(const Entry &entry) const
+    {
+        return entry.fetchTime.secsTo(QDateTime::currentDateTimeUtc()) > mTimeToLive;
+    }
+
+    void load();
+    void changed();
+
+    QString mFileName;
+    QHash<QString, Entry> mEntries;
+    QTimer mSaveTimer;
+    qint64 mTimeToLive = 24 * 60 * 60;
+    bool mDirty = false;
+};
+
+// Only the times and types of the periods are stored, see the class
+// documentation.
+static void writeFreeBusy(QDataStream &stream, const KCalendarCore::FreeBusy::Ptr &freeBusy)
+{
+    const KCalendarCore::FreeBusyPeriod::List periods = freeBusy->fullBusyPeriods();
+    stream << quint32(periods.size());
+    for (const KCalendarCore::FreeBusyPeriod &period : periods) {
+        stream << period.start() << period.end() << qint32(period.type());
+    }
+}
+
+static KCalendarCore::FreeBusy::Ptr readFreeBusy(QDataStream &stream)
+{
+    quint32 count = 0;
+    stream >> count;
+    KCalendarCore::FreeBusyPeriod::List periods;
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        QDateTime start;
+        QDateTime end;
+        qint32 type = 0;
+        stream >> start >> end >> type;
+        KCalendarCore::FreeBusyPeriod period(start, end);
+        period.setType(static_cast<KCalendarCore::FreeBusyPeriod::FreeBusyType>(type));
+        periods.append(period);
+    }
+    return KCalendarCore::FreeBusy::Ptr(new KCalendarCore::FreeBusy(periods));
+}
+
+void FreeBusyCachePrivate::load()
+{
+    QFile file(mFileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    QDataStream stream(&file);
+    quint32 magic = 0;
+    quint32 version = 0;
+    stream >> magic >> version;
+    if (magic != cacheMagic || version != cacheVersion) {
+        qCDebug(CALENDARSUPPORT_LOG) << "Ignoring free/busy cache with unknown format" << mFileName;
+        return;
+    }
+    stream.setVersion(QDataStream::Qt_6_0);
+
+    quint32 count = 0;
+    stream >> count;
+    mEntries.reserve(count);
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        QString email;
+        Entry entry;
+        stream >> email >> entry.fetchTime;
+        entry.freeBusy = readFreeBusy(stream);
+        if (stream.status() == QDataStream::Ok && !isExpired(entry)) {
+            mEntries.insert(email, entry);
+        }
+    }
+    if (stream.status() != QDataStream::Ok) {
+        qCWarning(CALENDARSUPPORT_LOG) << "Free/busy cache is damaged, dropping it" << mFileName;
+        mEntries.clear();
+    }
+}
+
+void FreeBusyCachePrivate::changed()
+{
+    mDirty = true;
+    // Write a burst of replies at once
+    if (!mSaveTimer.isActive()) {
+        mSaveTimer.start();
+    }
+}
+
+FreeBusyCache::FreeBusyCache(const QString &fileName, QObject *parent)
+    : QObject(parent)
+    , d(new FreeBusyCachePrivate)
+{
+    d->mFileName = fileName;
+    if (d->mFileName.isEmpty()) {
+        d->mFileName = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QLatin1String("/freebusy.cache");
+    }
+
+    d->mSaveTimer.setSingleShot(true);
+    d->mSaveTimer.setInterval(5000);
+    connect(&d->mSaveTimer, &QTimer::timeout, this, &FreeBusyCache::save);
+
+    // Read up front rather than on the first lookup, which happens while
+    // attendees are added to a view
+    d->load();
+}
+
+FreeBusyCache::~FreeBusyCache()
+{
+    save();
+}
+
+FreeBusyCache *FreeBusyCache::instance()
+{
+    // Owned by the application, so it is saved before the application quits
+    static QPointer<FreeBusyCache> cache;
+    if (!cache) {
+        cache = new FreeBusyCache(QString(), QCoreApplication::instance());
+    }
+    return cache;
+}
+
+QString FreeBusyCache::fileName() const
+{
+    return d->mFileName;
+}
+
+void FreeBusyCache::setTimeToLive(qint64 seconds)
+{
+    d->mTimeToLive = seconds;
+}
+
+qint64 FreeBusyCache::timeToLive() const
+{
+    return d->mTimeToLive;
+}
+
+KCalendarCore::FreeBusy::Ptr FreeBusyCache::freeBusy(const QString &email) const
+{
+    const auto it = d->mEntries.constFind(FreeBusyCachePrivate::normalizedEmail(email));
+    if (it == d->mEntries.cend() || d->isExpired(*it)) {
+        return {};
+    }
+    return it->freeBusy;
+}
+
+QDateTime FreeBusyCache::fetchTime(const QString &email) const
+{
+    return d->mEntries.value(FreeBusyCachePrivate::normalizedEmail(email)).fetchTime;
+}
+
+void FreeBusyCache::insert(const QString &email, const KCalendarCore::FreeBusy::Ptr &freebusy, const QDateTime &fetchTime)
+{
+    if (!freebusy) {
+        return;
+    }
+    d->mEntries.insert(FreeBusyCachePrivate::normalizedEmail(email),
+                       {fetchTime.isValid() ? fetchTime.toUTC() : QDateTime::currentDateTimeUtc(), freebusy});
+    d->changed();
+}
+
+void FreeBusyCache::remove(const QString &email)
+{
+    if (d->mEntries.remove(FreeBusyCachePrivate::normalizedEmail(email))) {
+        d->changed();
+    }
+}
+
+void FreeBusyCache::clear()
+{
+    d->mEntries.clear();
+    d->changed();
+}
+
+bool FreeBusyCache::save()
+{
+    d->mSaveTimer.stop();
+    if (!d->mDirty) {
+        return true;
+    }
+
+    QDir().mkpath(QFileInfo(d->mFileName).absolutePath());
+    QSaveFile file(d->mFileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCWarning(CALENDARSUPPORT_LOG) << "Unable to write free/busy cache" << d->mFileName << file.errorString();
+        return false;
+    }
+    file.setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner);
+
+    QDataStream stream(&file);
+    stream << cacheMagic << cacheVersion;
+    stream.setVersion(QDataStream::Qt_6_0);
+
+    QList<QString> emails;
+    emails.reserve(d->mEntries.size());
+    for (auto it = d->mEntries.cbegin(); it != d->mEntries.cend(); ++it) {
+        if (!d->isExpired(it.value())) {
+            emails.append(it.key());
+        }
+    }
+    stream << quint32(emails.size());
+    for (const QString &email : std::as_const(emails)) {
+        const FreeBusyCachePrivate::Entry entry = d->mEntries.value(email);
+        stream << email << entry.fetchTime;
+        writeFreeBusy(stream, entry.freeBusy);
+    }
+
+    if (!file.commit()) {
+        qCWarning(CALENDARSUPPORT_LOG) << "Unable to write free/busy cache" << d->mFileName << file.errorString();
+        return false;
+    }
+    d->mDirty = false;
+    return true;
+}
+
+#include "moc_freebusycache.cpp"
@@ -0,0 +1,91 @@
+/*
+  SPDX-FileCopyrightText: 2026 KDE PIM Authors
+
+  SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "calendarsupport_private_export.h"
+
+#include <KCalendarCore/FreeBusy>
+
+#include <QObject>
+
+#include <memory>
+
+namespace CalendarSupport
+{
+class FreeBusyCachePrivate;
+
+/**
+ * The FreeBusyCache keeps the last known free/busy data of each email
+ * address in a file, so that it is available before a retrieval finishes.
+ *
+ * Entries are keyed by the normalized email address and expire after
+ * timeToLive() seconds. Changes are written back to the file shortly after
+ * they are made, and when the cache is destroyed.
+ *
+ * The file holds other people's schedules, so only the start, end and
+ * type of their busy periods are written, never summaries or locations,
+ * and only the user can read it. The file is read when the cache is
+ * created.
+ *
+ * Internal to the library, see FreeBusyItemModel::setFreeBusyCacheEnabled().
+ */
+class CALENDARSUPPORT_TESTS_EXPORT FreeBusyCache : public QObject
+{
+    Q_OBJECT
+public:
+    /**
+     * @param fileName the file to store the cache in. If empty, a file in
+     * QStandardPaths::CacheLocation is used.
+     */
+    explicit FreeBusyCache(const QString &fileName = QString(), QObject *parent = nullptr);
+    ~FreeBusyCache() override;
+
+    /**
+     * Returns the cache shared by the whole application.
+     */
+    static FreeBusyCache *instance();
+
+    [[nodiscard]] QString fileName() const;
+
+    /**
+     * Sets how many seconds an entry stays valid after it was fetched.
+     * The default is one day.
+     */
+    void setTimeToLive(qint64 seconds);
+    [[nodiscard]] qint64 timeToLive() const;
+
+    /**
+     * Returns the cached free/busy data of @p email, or a null pointer if
+     * there is none or it expired. Data read from the file has no
+     * summaries or locations.
+     */
+    [[nodiscard]] KCalendarCore::FreeBusy::Ptr freeBusy(const QString &email) const;
+
+    /**
+     * Returns when the cached data of @p email was fetched, or an invalid
+     * QDateTime if there is none.
+     */
+    [[nodiscard]] QDateTime fetchTime(const QString &email) const;
+
+    /**
+     * Stores @p freebusy as the data of @p email fetched at @p fetchTime,
+     * or now if @p fetchTime is invalid.
+     */
+    void insert(const QString &email, const KCalendarCore::FreeBusy::Ptr &freebusy, const QDateTime &fetchTime = QDateTime());
+    void remove(const QString &email);
+    void clear();
+
+    /**
+     * Writes pending changes to the file now.
+     * @return false if the file could not be written.
+     */
+    bool save();
+
+private:
+    std::unique_ptr<FreeBusyCachePrivate> const d;
+};
+}
@@ -8,30 +8,217 @@
 #include "freebusycalendar.h"
 #include "calendarsupport_debug.h"
 
+#include <KCalendarCore/Attendee>
 #include <KCalendarCore/FreeBusyPeriod>
 #include <KCalendarCore/MemoryCalendar>
 
 #include <KLocalizedString>
 
+#include <QHash>
+#include <QPointer>
+#include <QSet>
 #include <QTimeZone>
+#include <QTimer>
+
+#include <utility>
 
 using namespace CalendarSupport;
 
+namespace
+{
+// Identifies the event of a busy period independently of the model rows,
+// which move when attendees or periods are added or removed. The
+// occurrence tells identical periods of the same email apart.
+struct EventKey {
+    QString email;
+    qint64 start;
+    qint64 end;
+    int occurrence;
+
+    bool operator==(const EventKey &other) const
+    {
+        return start == other.start && end == other.end && occurrence == other.occurrence && email == other.email;
+    }
+};
+
+size_t qHash(const EventKey &key, size_t seed = 0)
+{
+    return qHashMulti(seed, key.email, key.start, key.end, key.occurrence);
+}
+
+QString normalizedEmail(const QString &email)
+{
+    return email.trimmed().toLower();
+}
+
+// Returns the emails of the attendees the rows first to last of parent belong to
+QStringList attendeeEmails(const QAbstractItemModel *model, const QModelIndex &parent, int first, int last)
+{
+    QStringList emails;
+    if (parent.isValid()) {
+        emails.append(model->data(parent, FreeBusyItemModel::AttendeeRole).value<KCalendarCore::Attendee>().email());
+    } else {
+        for (int i = first; i <= last; ++i) {
+            emails.append(model->data(model->index(i, 0), FreeBusyItemModel::AttendeeRole).value<KCalendarCore::Attendee>().email());
+        }
+    }
+    return emails;
+}
+
+QString periodSummary(const KCalendarCore::FreeBusyPeriod &period)
+{
+    if (!period.summary().isEmpty()) {
+        return period.summary();
+    }
+    switch (period.type()) {
+    case KCalendarCore::FreeBusyPeriod::Free:
+        return i18n("Free");
+    case KCalendarCore::FreeBusyPeriod::Busy:
+        return i18n("Busy");
+    case KCalendarCore::FreeBusyPeriod::BusyUnavailable:
+        return i18n("Unavailable");
+    case KCalendarCore::FreeBusyPeriod::BusyTentative:
+        return i18n("Tentative");
+    default:
+        return i18n("Unknown");
+    }
+}
+}
+
 class CalendarSupport::FreeBusyCalendarPrivate
 {
 public:
     FreeBusyCalendarPrivate() = default;
 
-    FreeBusyItemModel *mModel = nullptr;
+    // Returns the busy periods the model has for each of @p emails, or for
+    // all emails if @p emails is empty
+    [[nodiscard]] QHash<EventKey, KCalendarCore::FreeBusyPeriod> modelPeriods(const QSet<QString> &emails) const;
+    void addRowPeriods(int row, const QString &email, QHash<EventKey, KCalendarCore::FreeBusyPeriod> &periods) const;
+    // Returns whether the calendar changed
+    bool sync(const QSet<QString> &emails, const QHash<EventKey, KCalendarCore::FreeBusyPeriod> &periods);
+
+    // Model changes are applied later, by which time the model may be gone
+    QPointer<FreeBusyItemModel> mModel;
     KCalendarCore::Calendar::Ptr mCalendar;
-    QMap<QModelIndex, KCalendarCore::Event::Ptr> mFbEvent;
+    QDateTime mRangeStart;
+    QDateTime mRangeEnd;
+    QHash<EventKey, KCalendarCore::Event::Ptr> mFbEvent;
+    QHash<QString, QSet<EventKey>> mKeysByEmail;
+    // Emails of the attendee rows about to be removed
+    QStringList mRemovedEmails;
+    // Model changes not applied to the calendar yet, by normalized email
+    QSet<QString> mPendingEmails;
+    bool mPendingAll = false;
+    QTimer mSyncTimer;
 };
 
+QHash<EventKey, KCalendarCore::FreeBusyPeriod> FreeBusyCalendarPrivate::modelPeriods(const QSet<QString> &emails) const
+{
+    QHash<EventKey, KCalendarCore::FreeBusyPeriod> periods;
+    if (!mModel) {
+        return periods;
+    }
+    if (emails.isEmpty()) {
+        for (int row = 0, count = mModel->rowCount(); row < count; ++row) {
+            const auto attendee = mModel->data(mModel->index(row, 0), FreeBusyItemModel::AttendeeRole).value<KCalendarCore::Attendee>();
+            addRowPeriods(row, normalizedEmail(attendee.email()), periods);
+        }
+        return periods;
+    }
+    // Only the rows of the changed attendees, found through the model's index
+    for (const QString &email : emails) {
+        const QList<int> rows = mModel->rowsForEmail(email);
+        for (const int row : rows) {
+            addRowPeriods(row, email, periods);
+        }
+    }
+    return periods;
+}
+
+void FreeBusyCalendarPrivate::addRowPeriods(int row, const QString &email, QHash<EventKey, KCalendarCore::FreeBusyPeriod> &periods) const
+{
+    const KCalendarCore::FreeBusyPeriod::List busyPeriods = mModel->busyPeriods(row);
+    for (const KCalendarCore::FreeBusyPeriod &period : busyPeriods) {
+        if (mRangeEnd.isValid() && period.start() >= mRangeEnd) {
+            // The periods are sorted by start, all others start later
+            break;
+        }
+        if (mRangeStart.isValid() && period.end() <= mRangeStart) {
+            continue;
+        }
+        EventKey key{email, period.start().toMSecsSinceEpoch(), period.end().toMSecsSinceEpoch(), 0};
+        while (periods.contains(key)) {
+            ++key.occurrence;
+        }
+        periods.insert(key, period);
+    }
+}
+
+bool FreeBusyCalendarPrivate::sync(const QSet<QString> &emails, const QHash<EventKey, KCalendarCore::FreeBusyPeriod> &periods)
+{
+    bool changed = false;
+    // Events of periods that are gone
+    for (const QString &email : emails) {
+        auto keys = mKeysByEmail.find(email);
+        if (keys == mKeysByEmail.end()) {
+            continue;
+        }
+        for (auto it = keys->begin(); it != keys->end();) {
+            if (periods.contains(*it)) {
+                ++it;
+                continue;
+            }
+            mCalendar->deleteEvent(mFbEvent.take(*it));
+            it = keys->erase(it);
+            changed = true;
+        }
+        if (keys->isEmpty()) {
+            mKeysByEmail.erase(keys);
+        }
+    }
+
+    // New periods, and periods with new details
+    for (auto it = periods.cbegin(); it != periods.cend(); ++it) {
+        const KCalendarCore::FreeBusyPeriod &period = it.value();
+        const QString summary = periodSummary(period);
+        const QString status = QString::number(period.type());
+
+        KCalendarCore::Event::Ptr inc = mFbEvent.value(it.key());
+        if (inc) {
+            if (inc->summary() != summary || inc->customProperty("FREEBUSY", "STATUS") != status) {
+                mCalendar->beginChange(inc);
+                inc->setSummary(summary);
+                inc->setCustomProperty("FREEBUSY", "STATUS", status);
+                mCalendar->endChange(inc);
+                changed = true;
+            }
+            continue;
+        }
+
+        const EventKey &key = it.key();
+        inc = KCalendarCore::Event::Ptr(new KCalendarCore::Event());
+        inc->setDtStart(period.start());
+        inc->setDtEnd(period.end());
+        inc->setUid(QStringLiteral("fb-%1-%2-%3-%4").arg(key.email).arg(key.start).arg(key.end).arg(key.occurrence));
+        inc->setCustomProperty("FREEBUSY", "STATUS", status);
+        inc->setSummary(summary);
+
+        mFbEvent.insert(key, inc);
+        mKeysByEmail[key.email].insert(key);
+        mCalendar->addEvent(inc);
+        changed = true;
+    }
+    return changed;
+}
+
 FreeBusyCalendar::FreeBusyCalendar(QObject *parent)
     : QObject(parent)
     , d(new CalendarSupport::FreeBusyCalendarPrivate)
 {
     d->mCalendar = KCalendarCore::Calendar::Ptr(new KCalendarCore::MemoryCalendar(QTimeZone::systemTimeZone()));
+    // A model update comes as a burst of signals; apply them all at once
+    d->mSyncTimer.setSingleShot(true);
+    connect(&d->mSyncTimer, &QTimer::timeout, this, &FreeBusyCalendar::applyChanges);
     qCDebug(CALENDARSUPPORT_LOG) << "creating" << this;
 }
 
@@ -45,6 +232,33 @@ KCalendarCore::Calendar::Ptr FreeBusyCalendar::calendar() const
     return d->mCalendar;
 }
 
+void FreeBusyCalendar::flush()
+{
+    applyChanges();
+}
+
+void FreeBusyCalendar::setMaterializedRange(const QDateTime &start, const QDateTime &end)
+{
+    if (start == d->mRangeStart && end == d->mRangeEnd) {
+        return;
+    }
+    d->mRangeStart = start;
+    d->mRangeEnd = end;
+    // Evicts the events that left the range and creates the ones that entered it
+    queueSyncAll();
+    applyChanges();
+}
+
+QDateTime FreeBusyCalendar::materializedStart() const
+{
+    return d->mRangeStart;
+}
+
+QDateTime FreeBusyCalendar::materializedEnd() const
+{
+    return d->mRangeEnd;
+}
+
 FreeBusyItemModel *FreeBusyCalendar::model() const
 {
     return d->mModel;
@@ -54,107 +268,99 @@ void FreeBusyCalendar::setModel(FreeBusyItemModel *model)
 {
     if (model != d->mModel) {
         if (d->mModel) {
-            disconnect(d->mModel, nullptr, nullptr, nullptr);
+            disconnect(d->mModel, nullptr, this, nullptr);
         }
         d->mModel = model;
+        if (!d->mModel) {
+            queueSyncAll();
+            applyChanges();
+            return;
+        }
         connect(d->mModel, &QAbstractItemModel::layoutChanged, this, &FreeBusyCalendar::onLayoutChanged);
         connect(d->mModel, &QAbstractItemModel::modelReset, this, &FreeBusyCalendar::onLayoutChanged);
-        connect(d->mModel, &QAbstractItemModel::rowsAboutToBeRemoved, this, &FreeBusyCalendar::onRowsRemoved);
+        connect(d->mModel, &QAbstractItemModel::rowsAboutToBeRemoved, this, &FreeBusyCalendar::onRowsAboutToBeRemoved);
+        connect(d->mModel, &QAbstractItemModel::rowsRemoved, this, &FreeBusyCalendar::onRowsRemoved);
         connect(d->mModel, &QAbstractItemModel::rowsInserted, this, &FreeBusyCalendar::onRowsInserted);
         connect(d->mModel, &QAbstractItemModel::dataChanged, this, &FreeBusyCalendar::onRowsChanged);
+        connect(d->mModel, &QObject::destroyed, this, [this]() {
+            // The queued changes can't be read from the model anymore; its
+            // events are all removed instead
+            d->mModel = nullptr;
+            d->mPendingEmails.clear();
+            d->mRemovedEmails.clear();
+            queueSyncAll();
+        });
+        queueSyncAll();
+        applyChanges();
     }
 }
 
-void FreeBusyCalendar::deleteAllEvents()
+void FreeBusyCalendar::queueSync(const QStringList &emails)
 {
-    const KCalendarCore::Event::List lstEvents = d->mCalendar->events();
-    for (const KCalendarCore::Event::Ptr &event : lstEvents) {
-        d->mCalendar->deleteEvent(event);
+    for (const QString &email : emails) {
+        d->mPendingEmails.insert(normalizedEmail(email));
     }
+    d->mSyncTimer.start(0);
 }
 
-void FreeBusyCalendar::onLayoutChanged()
+void FreeBusyCalendar::queueSyncAll()
 {
-    if (!d->mFbEvent.isEmpty()) {
-        deleteAllEvents();
-        d->mFbEvent.clear();
-        for (int i = d->mModel->rowCount() - 1; i >= 0; --i) {
-            QModelIndex parent = d->mModel->index(i, 0);
-            onRowsInserted(parent, 0, d->mModel->rowCount(parent) - 1);
-        }
-    }
+    d->mPendingAll = true;
+    d->mSyncTimer.start(0);
 }
 
-void FreeBusyCalendar::onRowsInserted(const QModelIndex &parent, int first, int last)
+void FreeBusyCalendar::applyChanges()
 {
-    if (!parent.isValid()) {
+    d->mSyncTimer.stop();
+    QSet<QString> emails = std::exchange(d->mPendingEmails, {});
+    QHash<EventKey, KCalendarCore::FreeBusyPeriod> periods;
+    if (std::exchange(d->mPendingAll, false)) {
+        periods = d->modelPeriods({});
+        for (auto it = d->mKeysByEmail.cbegin(); it != d->mKeysByEmail.cend(); ++it) {
+            emails.insert(it.key());
+        }
+    } else if (!emails.isEmpty()) {
+        periods = d->modelPeriods(emails);
+    } else {
         return;
     }
-    for (int i = first; i <= last; ++i) {
-        QModelIndex index = d->mModel->index(i, 0, parent);
 
-        const KCalendarCore::FreeBusyPeriod &period = d->mModel->data(index, FreeBusyItemModel::FreeBusyPeriodRole).value<KCalendarCore::FreeBusyPeriod>();
-        const KCalendarCore::FreeBusy::Ptr &fb = d->mModel->data(parent, FreeBusyItemModel::FreeBusyRole).value<KCalendarCore::FreeBusy::Ptr>();
+    d->mCalendar->startBatchAdding();
+    const bool changed = d->sync(emails, periods);
+    d->mCalendar->endBatchAdding();
+    if (changed) {
+        Q_EMIT calendarUpdated();
+    }
+}
 
-        KCalendarCore::Event::Ptr inc = KCalendarCore::Event::Ptr(new KCalendarCore::Event());
-        inc->setDtStart(period.start());
-        inc->setDtEnd(period.end());
-        inc->setUid(QLatin1String("fb-") + fb->uid() + QLatin1String("-") + QString::number(i));
-
-        inc->setCustomProperty("FREEBUSY", "STATUS", QString::number(period.type()));
-        QString summary = period.summary();
-        if (summary.isEmpty()) {
-            switch (period.type()) {
-            case KCalendarCore::FreeBusyPeriod::Free:
-                summary = i18n("Free");
-                break;
-            case KCalendarCore::FreeBusyPeriod::Busy:
-                summary = i18n("Busy");
-                break;
-            case KCalendarCore::FreeBusyPeriod::BusyUnavailable:
-                summary = i18n("Unavailable");
-                break;
-            case KCalendarCore::FreeBusyPeriod::BusyTentative:
-                summary = i18n("Tentative");
-                break;
-            default:
-                summary = i18n("Unknown");
-            }
-        }
-        inc->setSummary(summary);
+void FreeBusyCalendar::onLayoutChanged()
+{
+    // The events are not bound to rows, so only what really changed is
+    // applied to the calendar
+    queueSyncAll();
+}
 
-        d->mFbEvent.insert(index, inc);
-        d->mCalendar->addEvent(inc);
-    }
+void FreeBusyCalendar::onRowsInserted(const QModelIndex &parent, int first, int last)
+{
+    queueSync(attendeeEmails(d->mModel, parent, first, last));
+}
+
+void FreeBusyCalendar::onRowsAboutToBeRemoved(const QModelIndex &parent, int first, int last)
+{
+    d->mRemovedEmails += attendeeEmails(d->mModel, parent, first, last);
 }
 
 void FreeBusyCalendar::onRowsRemoved(const QModelIndex &parent, int first, int last)
 {
-    if (!parent.isValid()) {
-        for (int i = first; i <= last; ++i) {
-            QModelIndex index = d->mModel->index(i, 0);
-            onRowsRemoved(index, 0, d->mModel->rowCount(index) - 1);
-        }
-    } else {
-        for (int i = first; i <= last; ++i) {
-            QModelIndex index = d->mModel->index(i, 0, parent);
-            KCalendarCore::Event::Ptr inc = d->mFbEvent.take(index);
-            d->mCalendar->deleteEvent(inc);
-        }
-    }
+    Q_UNUSED(parent)
+    Q_UNUSED(first)
+    Q_UNUSED(last)
+    queueSync(std::exchange(d->mRemovedEmails, {}));
 }
 
 void FreeBusyCalendar::onRowsChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
 {
-    if (!topLeft.parent().isValid()) {
-        return;
-    }
-    for (int i = topLeft.row(); i <= bottomRight.row(); ++i) {
-        QModelIndex index = d->mModel->index(i, 0, topLeft.parent());
-        KCalendarCore::Event::Ptr inc = d->mFbEvent.value(index);
-        d->mCalendar->beginChange(inc);
-        d->mCalendar->endChange(inc);
-    }
+    queueSync(attendeeEmails(d->mModel, topLeft.parent(), topLeft.row(), bottomRight.row()));
 }
 
 #include "moc_freebusycalendar.cpp"
@@ -37,14 +37,45 @@ public:
     FreeBusyItemModel *model() const;
 
     /// Get the calendar created from the FreeBusyItemModel.
+    ///
+    /// Model changes are applied to it once control returns to the event loop,
+    /// see flush(). Events are updated in place, so that the events of unchanged
+    /// periods stay the same objects. Observers registered with
+    /// KCalendarCore::Calendar::registerObserver() still get one notification per
+    /// added, changed or removed event; connect to calendarUpdated() to be told
+    /// once per burst of changes instead.
     KCalendarCore::Calendar::Ptr calendar() const;
 
+    /// Apply pending model changes to calendar() right away, e.g. to read it
+    /// right after changing the model.
+    void flush();
+
+    /// Only create events for busy periods overlapping the time from @p start up to @p end.
+    /// Events of periods outside of it are removed from the calendar. Invalid times, the
+    /// default, create events for all busy periods.
+    void setMaterializedRange(const QDateTime &start, const QDateTime &end);
+
+    /// Get the start of the range events are created for.
+    [[nodiscard]] QDateTime materializedStart() const;
+
+    /// Get the end of the range events are created for.
+    [[nodiscard]] QDateTime materializedEnd() const;
+
+Q_SIGNALS:
+    /// Emitted once after a burst of model changes was applied to calendar(),
+    /// if any event was added, changed or removed. This is the notification to
+    /// redraw on; unlike the per-event observer callbacks it is batched.
+    void calendarUpdated();
+
 private:
     CALENDARSUPPORT_NO_EXPORT void onRowsChanged(const QModelIndex &, const QModelIndex &);
     CALENDARSUPPORT_NO_EXPORT void onRowsInserted(const QModelIndex &, int, int);
+    CALENDARSUPPORT_NO_EXPORT void onRowsAboutToBeRemoved(const QModelIndex &, int, int);
     CALENDARSUPPORT_NO_EXPORT void onRowsRemoved(const QModelIndex &, int, int);
     CALENDARSUPPORT_NO_EXPORT void onLayoutChanged();
-    CALENDARSUPPORT_NO_EXPORT void deleteAllEvents();
+    CALENDARSUPPORT_NO_EXPORT void queueSync(const QStringList &emails);
+    CALENDARSUPPORT_NO_EXPORT void queueSyncAll();
+    CALENDARSUPPORT_NO_EXPORT void applyChanges();
 
     std::unique_ptr<FreeBusyCalendarPrivate> const d;
 };
@@ -55,12 +55,17 @@ int FreeBusyItem::updateTimerID() const
 void FreeBusyItem::startDownload(bool forceDownload)
 {
     mIsDownloading = true;
-    Akonadi::FreeBusyManager *m = Akonadi::FreeBusyManager::self();
-    if (!m->retrieveFreeBusy(attendee().email(), forceDownload, mParentWidget)) {
+    if (!retrieveFreeBusy(forceDownload)) {
         mIsDownloading = false;
     }
 }
 
+bool FreeBusyItem::retrieveFreeBusy(bool forceDownload)
+{
+    Akonadi::FreeBusyManager *m = Akonadi::FreeBusyManager::self();
+    return m->retrieveFreeBusy(attendee().email(), forceDownload, mParentWidget);
+}
+
 void FreeBusyItem::setIsDownloading(bool d)
 {
     mIsDownloading = d;
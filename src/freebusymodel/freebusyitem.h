@@ -38,6 +38,16 @@ public:
     [[nodiscard]] int updateTimerID() const;
 
     void startDownload(bool forceDownload);
+
+    /**
+     * Asks Akonadi for the free/busy data of the attendee, without
+     * changing isDownloading(). Returns false if nothing was retrieved.
+     * Otherwise the data arrives through
+     * Akonadi::FreeBusyManager::freeBusyRetrieved(), exactly once: for the
+     * user's own address and for locally cached free/busy files it is
+     * delivered before this returns, for others later.
+     */
+    [[nodiscard]] bool retrieveFreeBusy(bool forceDownload);
     void setIsDownloading(bool d);
     [[nodiscard]] bool isDownloading() const;
 
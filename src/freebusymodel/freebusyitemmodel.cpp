@@ -6,13 +6,18 @@
 */
 
 #include "freebusyitemmodel.h"
+#include "freebusyitemmodel_p.h"
 
 #include <Akonadi/FreeBusyManager>
 
+#include <KCalendarCore/FreeBusyPeriod>
+
 #include <KLocalizedString>
 
 #include <QLocale>
-#include <QTimerEvent>
+
+#include <algorithm>
+#include <limits>
 
 using namespace CalendarSupport;
 
@@ -36,12 +41,15 @@ public:
 
     void appendChild(ItemPrivateData *item)
     {
+        item->mRow = childItems.count();
         childItems.append(item);
     }
 
     ItemPrivateData *removeChild(int row)
     {
-        return childItems.takeAt(row);
+        ItemPrivateData *item = childItems.takeAt(row);
+        renumberChildren(row);
+        return item;
     }
 
     [[nodiscard]] int childCount() const
@@ -49,12 +57,41 @@ public:
         return childItems.count();
     }
 
-    [[nodiscard]] int row() const
+    [[nodiscard]] const KCalendarCore::FreeBusyPeriod::List &busyPeriods() const
+    {
+        return mBusyPeriods;
+    }
+
+    // Inserts a child for each of the periods first to last of @p periods
+    void insertBusyPeriods(int row, const KCalendarCore::FreeBusyPeriod::List &periods, qsizetype first, qsizetype last)
     {
-        if (parentItem) {
-            return parentItem->childItems.indexOf(const_cast<ItemPrivateData *>(this));
+        for (qsizetype i = first; i <= last; ++i) {
+            childItems.insert(row, new ItemPrivateData(this));
+            mBusyPeriods.insert(row, periods.at(i));
+            ++row;
         }
-        return 0;
+        renumberChildren(row - (last - first + 1));
+    }
+
+    void removeBusyPeriods(int row, int count)
+    {
+        for (int i = 0; i < count; ++i) {
+            delete childItems.takeAt(row);
+        }
+        mBusyPeriods.remove(row, count);
+        renumberChildren(row);
+    }
+
+    void setBusyPeriod(int row, const KCalendarCore::FreeBusyPeriod &period)
+    {
+        mBusyPeriods[row] = period;
+    }
+
+    // Kept up to date by the parent, so that parent() and data() need not
+    // search the siblings for every index.
+    [[nodiscard]] int row() const
+    {
+        return mRow;
     }
 
     ItemPrivateData *parent()
@@ -63,23 +100,253 @@ public:
     }
 
 private:
+    void renumberChildren(int from)
+    {
+        for (int i = from; i < childItems.count(); ++i) {
+            childItems.at(i)->mRow = i;
+        }
+    }
+
     QList<ItemPrivateData *> childItems;
     ItemPrivateData *parentItem = nullptr;
+    int mRow = 0;
+    // The busy periods of an attendee, sorted, one for each child
+    KCalendarCore::FreeBusyPeriod::List mBusyPeriods;
 };
 
-class CalendarSupport::FreeBusyItemModelPrivate
+static bool startsBefore(const KCalendarCore::FreeBusyPeriod &a, const KCalendarCore::FreeBusyPeriod &b)
 {
-public:
-    ~FreeBusyItemModelPrivate()
-    {
-        delete mRootData;
+    return a.start() < b.start() || (a.start() == b.start() && a.end() < b.end());
+}
+
+static KCalendarCore::FreeBusyPeriod::List sortedBusyPeriods(const KCalendarCore::FreeBusy::Ptr &fb)
+{
+    KCalendarCore::FreeBusyPeriod::List periods = fb->fullBusyPeriods();
+    std::stable_sort(periods.begin(), periods.end(), startsBefore);
+    return periods;
+}
+
+static bool sameTime(const KCalendarCore::FreeBusyPeriod &a, const KCalendarCore::FreeBusyPeriod &b)
+{
+    return a.start() == b.start() && a.end() == b.end();
+}
+
+static bool samePeriod(const KCalendarCore::FreeBusyPeriod &a, const KCalendarCore::FreeBusyPeriod &b)
+{
+    return sameTime(a, b) && a.type() == b.type() && a.summary() == b.summary() && a.location() == b.location();
+}
+
+FreeBusyItemModelPrivate::~FreeBusyItemModelPrivate()
+{
+    delete mRootData;
+}
+
+FreeBusyItemModelPrivate *FreeBusyItemModelPrivate::get(FreeBusyItemModel *model)
+{
+    return model->d.get();
+}
+
+void FreeBusyItemModelPrivate::cancelUpdate(const FreeBusyItem::Ptr &item)
+{
+    if (mUpdateIds.remove(item.data())) {
+        mPendingUpdates.erase(std::remove_if(mPendingUpdates.begin(),
+                                             mPendingUpdates.end(),
+                                             [&item](const PendingUpdate &update) {
+                                                 return update.item == item;
+                                             }),
+                              mPendingUpdates.end());
+        if (mPendingUpdates.empty()) {
+            mUpdateTimer.stop();
+        }
     }
+}
 
-    QTimer mReloadTimer;
-    bool mForceDownload = false;
-    QList<FreeBusyItem::Ptr> mFreeBusyItems;
-    ItemPrivateData *mRootData = nullptr;
-};
+bool FreeBusyItemModelPrivate::hasPendingUpdate(const FreeBusyItem::Ptr &item) const
+{
+    return mUpdateIds.contains(item.data());
+}
+
+void FreeBusyItemModelPrivate::indexRow(int row)
+{
+    mRowsByEmail[normalizedEmail(mFreeBusyItems.at(row)->email())].append(row);
+}
+
+void FreeBusyItemModelPrivate::unindexRow(int row)
+{
+    const QString email = normalizedEmail(mFreeBusyItems.at(row)->email());
+    auto it = mRowsByEmail.find(email);
+    if (it != mRowsByEmail.end()) {
+        it->removeOne(row);
+        if (it->isEmpty()) {
+            mRowsByEmail.erase(it);
+        }
+    }
+
+    // The rows after the removed one move up. Only their own entries change,
+    // which keeps the lists of all other emails untouched.
+    for (int other = row + 1; other < mFreeBusyItems.size(); ++other) {
+        QList<int> &rows = mRowsByEmail[normalizedEmail(mFreeBusyItems.at(other)->email())];
+        const auto entry = std::lower_bound(rows.begin(), rows.end(), other);
+        Q_ASSERT(entry != rows.end() && *entry == other);
+        --*entry;
+    }
+}
+
+QList<int> FreeBusyItemModelPrivate::rowsForEmail(const QString &email) const
+{
+    return mRowsByEmail.value(normalizedEmail(email));
+}
+
+bool FreeBusyItemModelPrivate::takeNextDownload(QString &email, QueuedDownload &download)
+{
+    for (auto order : {&mPriorityOrder, &mDownloadOrder}) {
+        while (!order->empty()) {
+            const OrderEntry entry = order->front();
+            order->pop_front();
+            const auto queued = mQueuedDownloads.constFind(entry.first);
+            if (queued != mQueuedDownloads.cend() && queued->ticket == entry.second) {
+                email = entry.first;
+                download = *queued;
+                mQueuedDownloads.erase(queued);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void FreeBusyItemModelPrivate::setDownloading(const QString &email, bool downloading)
+{
+    const QList<int> rows = rowsForEmail(email);
+    for (const int row : rows) {
+        mFreeBusyItems.at(row)->setIsDownloading(downloading);
+    }
+}
+
+int FreeBusyItemModelPrivate::rowOfAttendee(const KCalendarCore::Attendee &attendee) const
+{
+    const auto rows = mRowsByEmail.constFind(normalizedEmail(attendee.email()));
+    if (rows != mRowsByEmail.cend()) {
+        for (const int row : *rows) {
+            if (mFreeBusyItems.at(row)->attendee() == attendee) {
+                return row;
+            }
+        }
+    }
+    return -1;
+}
+
+void FreeBusyItemModelPrivate::startDueDownloads()
+{
+    const qint64 now = mUpdateClock.elapsed();
+    while (!mPendingUpdates.empty() && mPendingUpdates.front().deadline <= now) {
+        const auto &update = mPendingUpdates.front();
+        // Skip updates that were rescheduled meanwhile
+        const auto latest = mUpdateIds.constFind(update.item.data());
+        if (latest != mUpdateIds.cend() && *latest == update.id) {
+            mUpdateIds.erase(latest);
+            queueDownload(update.item, mForceDownload, update.prioritized);
+        }
+        mPendingUpdates.pop_front();
+    }
+
+    if (!mPendingUpdates.empty()) {
+        mUpdateTimer.start(mPendingUpdates.front().deadline - now);
+    }
+
+    // Start all due downloads in one go, as far as there are free slots
+    startQueuedDownloads();
+}
+
+void FreeBusyItemModelPrivate::queueDownload(const FreeBusyItem::Ptr &item, bool forceDownload, bool prioritized)
+{
+    const QString email = normalizedEmail(item->email());
+    if (mRunningDownloads.contains(email)) {
+        // The reply will update every attendee with this email
+        return;
+    }
+
+    // Queued attendees are not downloading yet; they may be updated again
+    // meanwhile, which only merges into the queued download.
+    auto queued = mQueuedDownloads.find(email);
+    if (queued == mQueuedDownloads.end()) {
+        queued = mQueuedDownloads.insert(email, {item, forceDownload, prioritized, mNextTicket++});
+        (prioritized ? mPriorityOrder : mDownloadOrder).push_back({email, queued->ticket});
+        return;
+    }
+
+    queued->forceDownload |= forceDownload;
+    if (prioritized && !queued->prioritized) {
+        // Moves over to the prioritized downloads, the old place is stale
+        queued->prioritized = true;
+        queued->ticket = mNextTicket++;
+        mPriorityOrder.push_back({email, queued->ticket});
+    }
+}
+
+void FreeBusyItemModelPrivate::startQueuedDownloads()
+{
+    // Replies arriving while a retrieval starts call back in here; the loop
+    // below already takes up the slots they free.
+    if (mStartingDownloads) {
+        return;
+    }
+    mStartingDownloads = true;
+
+    QString email;
+    QueuedDownload download;
+    while (mRunningDownloads.size() < mMaxDownloads && takeNextDownload(email, download)) {
+        mRunningDownloads.insert(email, mUpdateClock.elapsed());
+        setDownloading(email, true);
+        mStartingEmail = email;
+        mStartingAnswered = false;
+        const bool started = mRetrieve(download.item, download.forceDownload);
+        mStartingEmail.clear();
+        if (!started || mStartingAnswered) {
+            mRunningDownloads.remove(email);
+            setDownloading(email, false);
+        }
+    }
+    mStartingDownloads = false;
+
+    if (!mRunningDownloads.isEmpty() && !mDownloadTimeoutTimer.isActive()) {
+        const qint64 oldest = *std::min_element(mRunningDownloads.cbegin(), mRunningDownloads.cend());
+        mDownloadTimeoutTimer.start(std::max<qint64>(0, oldest + mDownloadTimeout - mUpdateClock.elapsed()));
+    }
+}
+
+void FreeBusyItemModelPrivate::finishDownload(const QString &email)
+{
+    const QString key = normalizedEmail(email);
+    if (key == mStartingEmail) {
+        // Answered right away; startQueuedDownloads() frees the slot once
+        // the retrieval returns
+        mStartingAnswered = true;
+        return;
+    }
+    if (mRunningDownloads.remove(key)) {
+        // Also when the reply carried no data, the attendees may be updated
+        // again
+        setDownloading(key, false);
+        startQueuedDownloads();
+    }
+}
+
+void FreeBusyItemModelPrivate::expireDownloads()
+{
+    // Give up on retrievals that never answered, so they do not hold their
+    // slot forever
+    const qint64 now = mUpdateClock.elapsed();
+    for (auto it = mRunningDownloads.begin(); it != mRunningDownloads.end();) {
+        if (it.value() + mDownloadTimeout <= now) {
+            setDownloading(it.key(), false);
+            it = mRunningDownloads.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    startQueuedDownloads();
+}
 
 FreeBusyItemModel::FreeBusyItemModel(QObject *parent)
     : QAbstractItemModel(parent)
@@ -95,6 +362,17 @@ FreeBusyItemModel::FreeBusyItemModel(QObject *parent)
     connect(&d->mReloadTimer, &QTimer::timeout, this, &FreeBusyItemModel::autoReload);
     d->mReloadTimer.setSingleShot(true);
 
+    connect(&d->mUpdateTimer, &QTimer::timeout, this, [this]() {
+        d->startDueDownloads();
+    });
+    d->mUpdateTimer.setSingleShot(true);
+    d->mUpdateClock.start();
+
+    connect(&d->mDownloadTimeoutTimer, &QTimer::timeout, this, [this]() {
+        d->expireDownloads();
+    });
+    d->mDownloadTimeoutTimer.setSingleShot(true);
+
     d->mRootData = new ItemPrivateData(nullptr);
 }
 
@@ -130,12 +408,12 @@ QVariant FreeBusyItemModel::data(const QModelIndex &index, int role) const
         }
     }
 
-    FreeBusyItem::Ptr fbitem = d->mFreeBusyItems.at(data->parent()->row());
-    if (!fbitem->freeBusy() || index.row() >= fbitem->freeBusy()->busyPeriods().size()) {
+    const KCalendarCore::FreeBusyPeriod::List &periods = data->parent()->busyPeriods();
+    if (index.row() >= periods.size()) {
         return {};
     }
 
-    KCalendarCore::FreeBusyPeriod period = fbitem->freeBusy()->fullBusyPeriods().at(index.row());
+    const KCalendarCore::FreeBusyPeriod &period = periods.at(index.row());
     switch (role) {
     case Qt::DisplayRole: // return something to make modeltest happy
         return QStringLiteral("%1 - %2").arg(QLocale().toString(period.start().toLocalTime(), QLocale::ShortFormat),
@@ -215,18 +493,55 @@ QVariant FreeBusyItemModel::headerData(int section, Qt::Orientation orientation,
 
 void FreeBusyItemModel::addItem(const FreeBusyItem::Ptr &freebusy)
 {
-    int row = d->mFreeBusyItems.size();
-    beginInsertRows(QModelIndex(), row, row);
-    d->mFreeBusyItems.append(freebusy);
-    auto data = new ItemPrivateData(d->mRootData);
-    d->mRootData->appendChild(data);
+    // Callers adding many attendees one by one should not take the place of
+    // the prioritized ones
+    insertItems({freebusy}, false);
+}
+
+void FreeBusyItemModel::addItems(const QList<FreeBusyItem::Ptr> &items)
+{
+    insertItems(items, true);
+}
+
+void FreeBusyItemModel::insertItems(const QList<FreeBusyItem::Ptr> &items, bool prioritized)
+{
+    if (items.isEmpty()) {
+        return;
+    }
+
+    const int first = d->mFreeBusyItems.size();
+    beginInsertRows(QModelIndex(), first, first + items.size() - 1);
+    d->mFreeBusyItems.reserve(first + items.size());
+    for (const FreeBusyItem::Ptr &freebusy : items) {
+        if (!freebusy->freeBusy() && d->mCache) {
+            // Show the last known data until the download below refreshes it
+            const KCalendarCore::FreeBusy::Ptr cached = d->mCache->freeBusy(freebusy->email());
+            if (cached) {
+                freebusy->setFreeBusy(cached);
+            }
+        }
+
+        const int row = d->mFreeBusyItems.size();
+        d->mFreeBusyItems.append(freebusy);
+        d->indexRow(row);
+        auto data = new ItemPrivateData(d->mRootData);
+        d->mRootData->appendChild(data);
+        // The periods come with their new parent row, without signals of
+        // their own
+        if (freebusy->freeBusy()) {
+            const KCalendarCore::FreeBusyPeriod::List periods = sortedBusyPeriods(freebusy->freeBusy());
+            if (!periods.isEmpty()) {
+                data->insertBusyPeriods(0, periods, 0, periods.size() - 1);
+            }
+        }
+    }
     endInsertRows();
 
-    if (freebusy->freeBusy() && freebusy->freeBusy()->fullBusyPeriods().size() > 0) {
-        QModelIndex parent = index(row, 0);
-        setFreeBusyPeriods(parent, freebusy->freeBusy()->fullBusyPeriods());
+    // All of them are due at the same time, so their downloads start
+    // together
+    for (const FreeBusyItem::Ptr &freebusy : items) {
+        updateFreeBusyData(freebusy, prioritized);
     }
-    updateFreeBusyData(freebusy);
 }
 
 void FreeBusyItemModel::setFreeBusyPeriods(const QModelIndex &parent, const KCalendarCore::FreeBusyPeriod::List &list)
@@ -236,41 +551,75 @@ void FreeBusyItemModel::setFreeBusyPeriods(const QModelIndex &parent, const KCal
     }
 
     auto parentData = static_cast<ItemPrivateData *>(parent.internalPointer());
-    int fb_count = list.size();
-    int childCount = parentData->childCount();
-    QModelIndex first = index(0, 0, parent);
-    QModelIndex last = index(childCount - 1, 0, parent);
-
-    if (childCount > 0 && fb_count < childCount) {
-        beginRemoveRows(parent, fb_count - 1 < 0 ? 0 : fb_count - 1, childCount - 1);
-        for (int i = childCount - 1; i > fb_count; --i) {
-            delete parentData->removeChild(i);
-        }
-        endRemoveRows();
-        if (fb_count > 0) {
-            last = index(fb_count - 1, 0, parent);
-            Q_EMIT dataChanged(first, last);
+    const KCalendarCore::FreeBusyPeriod::List old = parentData->busyPeriods();
+
+    // Both lists are sorted, so walking them side by side finds the periods
+    // that went away and the ones that are new. A run of removed periods
+    // followed by a run of new ones at the same place is reported as changed
+    // rows, the rest as removed or inserted rows. Rows of periods that did not
+    // change are left alone.
+    int row = 0;
+    qsizetype oldPos = 0;
+    qsizetype newPos = 0;
+    int removed = 0;
+    int added = 0;
+    const auto flush = [&]() {
+        const int changed = std::min(removed, added);
+        const qsizetype firstAdded = newPos - added;
+        if (changed > 0) {
+            for (int i = 0; i < changed; ++i) {
+                parentData->setBusyPeriod(row + i, list.at(firstAdded + i));
+            }
+            Q_EMIT dataChanged(index(row, 0, parent), index(row + changed - 1, 0, parent));
         }
-    } else if (fb_count > childCount) {
-        beginInsertRows(parent, childCount, fb_count - 1);
-        for (int i = childCount; i < fb_count; ++i) {
-            auto childData = new ItemPrivateData(parentData);
-            parentData->appendChild(childData);
+        if (removed > changed) {
+            beginRemoveRows(parent, row + changed, row + removed - 1);
+            parentData->removeBusyPeriods(row + changed, removed - changed);
+            endRemoveRows();
+        } else if (added > changed) {
+            beginInsertRows(parent, row + changed, row + added - 1);
+            parentData->insertBusyPeriods(row + changed, list, firstAdded + changed, newPos - 1);
+            endInsertRows();
         }
-        endInsertRows();
-        if (childCount > 0) {
-            last = index(childCount - 1, 0, parent);
-            Q_EMIT dataChanged(first, last);
+        row += added;
+        removed = 0;
+        added = 0;
+    };
+
+    while (oldPos < old.size() || newPos < list.size()) {
+        if (oldPos < old.size() && newPos < list.size() && samePeriod(old.at(oldPos), list.at(newPos))) {
+            flush();
+            ++oldPos;
+            ++newPos;
+            ++row;
+        } else if (newPos == list.size() || (oldPos < old.size() && startsBefore(old.at(oldPos), list.at(newPos)))) {
+            ++removed;
+            ++oldPos;
+        } else if (oldPos == old.size() || !sameTime(old.at(oldPos), list.at(newPos))) {
+            ++added;
+            ++newPos;
+        } else {
+            // Same time, but the type, summary or location changed
+            ++removed;
+            ++oldPos;
+            ++added;
+            ++newPos;
         }
-    } else if (fb_count == childCount && fb_count > 0) {
-        Q_EMIT dataChanged(first, last);
     }
+    flush();
 }
 
 void FreeBusyItemModel::clear()
 {
     beginResetModel();
+    d->mPendingUpdates.clear();
+    d->mUpdateIds.clear();
+    d->mUpdateTimer.stop();
+    d->mQueuedDownloads.clear();
+    d->mPriorityOrder.clear();
+    d->mDownloadOrder.clear();
     d->mFreeBusyItems.clear();
+    d->mRowsByEmail.clear();
     delete d->mRootData;
     d->mRootData = new ItemPrivateData(nullptr);
     endResetModel();
@@ -279,7 +628,22 @@ void FreeBusyItemModel::clear()
 void FreeBusyItemModel::removeRow(int row)
 {
     beginRemoveRows(QModelIndex(), row, row);
+    const FreeBusyItem::Ptr item = d->mFreeBusyItems.at(row);
+    d->cancelUpdate(item);
+    d->unindexRow(row);
     d->mFreeBusyItems.removeAt(row);
+
+    // Hand a queued download over to another attendee with the same email
+    const QString email = FreeBusyItemModelPrivate::normalizedEmail(item->email());
+    auto queued = d->mQueuedDownloads.find(email);
+    if (queued != d->mQueuedDownloads.end() && queued->item == item) {
+        const QList<int> rows = d->rowsForEmail(email);
+        if (rows.isEmpty()) {
+            d->mQueuedDownloads.erase(queued);
+        } else {
+            queued->item = d->mFreeBusyItems.at(rows.first());
+        }
+    }
     ItemPrivateData *data = d->mRootData->removeChild(row);
     delete data;
     endRemoveRows();
@@ -287,91 +651,125 @@ void FreeBusyItemModel::removeRow(int row)
 
 void FreeBusyItemModel::removeItem(const FreeBusyItem::Ptr &freebusy)
 {
-    int row = d->mFreeBusyItems.indexOf(freebusy);
-    if (row >= 0) {
-        removeRow(row);
+    const QList<int> rows = d->rowsForEmail(freebusy->email());
+    for (const int row : rows) {
+        if (d->mFreeBusyItems.at(row) == freebusy) {
+            removeRow(row);
+            return;
+        }
     }
 }
 
 void FreeBusyItemModel::removeAttendee(const KCalendarCore::Attendee &attendee)
 {
-    FreeBusyItem::Ptr anItem;
-    for (int i = 0; i < d->mFreeBusyItems.count(); ++i) {
-        anItem = d->mFreeBusyItems[i];
-        if (anItem->attendee() == attendee) {
-            if (anItem->updateTimerID() != 0) {
-                killTimer(anItem->updateTimerID());
-            }
-            removeRow(i);
-            break;
-        }
+    const int row = d->rowOfAttendee(attendee);
+    if (row >= 0) {
+        removeRow(row);
     }
 }
 
 bool FreeBusyItemModel::containsAttendee(const KCalendarCore::Attendee &attendee)
 {
-    FreeBusyItem::Ptr anItem;
-    for (int i = 0; i < d->mFreeBusyItems.count(); ++i) {
-        anItem = d->mFreeBusyItems[i];
-        if (anItem->attendee() == attendee) {
-            return true;
-        }
-    }
-    return false;
+    return d->rowOfAttendee(attendee) >= 0;
+}
+
+KCalendarCore::FreeBusyPeriod::List FreeBusyItemModel::busyPeriods(int row) const
+{
+    const ItemPrivateData *data = d->mRootData->child(row);
+    return data ? data->busyPeriods() : KCalendarCore::FreeBusyPeriod::List();
 }
 
-void FreeBusyItemModel::updateFreeBusyData(const FreeBusyItem::Ptr &item)
+QList<int> FreeBusyItemModel::rowsForEmail(const QString &email) const
+{
+    return d->rowsForEmail(email);
+}
+
+void FreeBusyItemModel::updateFreeBusyData(const FreeBusyItem::Ptr &item, bool prioritized)
 {
     if (item->isDownloading()) {
         // This item is already in the process of fetching the FB list
         return;
     }
 
-    if (item->updateTimerID() != 0) {
-        // An update timer is already running. Reset it
-        killTimer(item->updateTimerID());
+    // This item does not have a download running. Do the download in one
+    // second; a new id supersedes any update already queued for this item.
+    static const qint64 updateDelay = 1000;
+    d->mNextUpdateId = d->mNextUpdateId == std::numeric_limits<int>::max() ? 1 : d->mNextUpdateId + 1;
+    const int id = d->mNextUpdateId;
+    d->mUpdateIds.insert(item.data(), id);
+    d->mPendingUpdates.push_back({d->mUpdateClock.elapsed() + updateDelay, id, item, prioritized});
+    if (!d->mUpdateTimer.isActive()) {
+        d->mUpdateTimer.start(updateDelay);
     }
-
-    // This item does not have a download running, and no timer is set
-    // Do the download in one second
-    item->setUpdateTimerID(startTimer(1000));
 }
 
 void FreeBusyItemModel::timerEvent(QTimerEvent *event)
 {
-    killTimer(event->timerId());
-    for (FreeBusyItem::Ptr item : std::as_const(d->mFreeBusyItems)) {
-        if (item->updateTimerID() == event->timerId()) {
-            item->setUpdateTimerID(0);
-            item->startDownload(d->mForceDownload);
-            return;
-        }
+    // Updates are no longer scheduled with a timer of their own
+    QAbstractItemModel::timerEvent(event);
+}
+
+void FreeBusyItemModel::setMaxConcurrentDownloads(int count)
+{
+    d->mMaxDownloads = std::max(1, count);
+    d->startQueuedDownloads();
+}
+
+int FreeBusyItemModel::maxConcurrentDownloads() const
+{
+    return d->mMaxDownloads;
+}
+
+void FreeBusyItemModel::prioritizeDownload(const FreeBusyItem::Ptr &freebusy)
+{
+    if (d->mQueuedDownloads.contains(FreeBusyItemModelPrivate::normalizedEmail(freebusy->email()))) {
+        d->queueDownload(freebusy, false, true);
     }
 }
 
 void FreeBusyItemModel::slotInsertFreeBusy(const KCalendarCore::FreeBusy::Ptr &fb, const QString &email)
 {
+    d->finishDownload(email);
+
     if (!fb) {
         return;
     }
 
+    if (d->mCache) {
+        d->mCache->insert(email, fb);
+    }
+
     if (fb->fullBusyPeriods().isEmpty()) {
         return;
     }
 
-    fb->sortList();
+    // Sorted once, here, for the child rows; the FreeBusy itself is handed
+    // out as it arrived.
+    const KCalendarCore::FreeBusyPeriod::List periods = sortedBusyPeriods(fb);
 
-    for (FreeBusyItem::Ptr item : std::as_const(d->mFreeBusyItems)) {
-        if (item->email() == email) {
-            item->setFreeBusy(fb);
-            const int row = d->mFreeBusyItems.indexOf(item);
-            const QModelIndex parent = index(row, 0);
-            Q_EMIT dataChanged(parent, parent);
-            setFreeBusyPeriods(parent, fb->fullBusyPeriods());
-        }
+    const bool downloading = d->mRunningDownloads.contains(FreeBusyItemModelPrivate::normalizedEmail(email));
+    const QList<int> rows = d->rowsForEmail(email);
+    for (const int row : rows) {
+        d->mFreeBusyItems.at(row)->setFreeBusy(fb);
+        // Only a reply that arrives while its retrieval starts leaves the
+        // download running, until the start returns
+        d->mFreeBusyItems.at(row)->setIsDownloading(downloading);
+        const QModelIndex parent = index(row, 0);
+        Q_EMIT dataChanged(parent, parent);
+        setFreeBusyPeriods(parent, periods);
     }
 }
 
+void FreeBusyItemModel::setFreeBusyCacheEnabled(bool enabled)
+{
+    d->mCache = enabled ? FreeBusyCache::instance() : nullptr;
+}
+
+bool FreeBusyItemModel::isFreeBusyCacheEnabled() const
+{
+    return !d->mCache.isNull();
+}
+
 void FreeBusyItemModel::autoReload()
 {
     d->mForceDownload = false;
@@ -382,11 +780,12 @@ void FreeBusyItemModel::reload()
 {
     for (FreeBusyItem::Ptr item : std::as_const(d->mFreeBusyItems)) {
         if (d->mForceDownload) {
-            item->startDownload(d->mForceDownload);
+            d->queueDownload(item, d->mForceDownload, false);
         } else {
             updateFreeBusyData(item);
         }
     }
+    d->startQueuedDownloads();
 }
 
 void FreeBusyItemModel::triggerReload()
@@ -26,6 +26,11 @@ namespace CalendarSupport
  * The top level parent nodes represent the freebusy items, and
  * the 2nd-level child nodes represent the FreeBusyPeriods of the parent
  * freebusy item.
+ *
+ * Free/busy data is matched to attendees by email ignoring case and
+ * surrounding white space, so "Fred@Example.com " and "fred@example.com"
+ * share their free/busy data and their downloads. removeAttendee() and
+ * containsAttendee() still compare whole attendees.
  */
 class FreeBusyItemModelPrivate;
 class CALENDARSUPPORT_EXPORT FreeBusyItemModel : public QAbstractItemModel
@@ -46,6 +51,14 @@ public:
 
     void addItem(const FreeBusyItem::Ptr &freebusy);
 
+    /**
+     * Adds all of @p items at the end of the model, in one insertion
+     * that already includes their known busy periods. The downloads of
+     * their free/busy data are scheduled together, and prioritized like
+     * with prioritizeDownload(); addItem() schedules a normal download.
+     */
+    void addItems(const QList<FreeBusyItem::Ptr> &items);
+
     void clear();
     void removeAttendee(const KCalendarCore::Attendee &attendee);
     void removeItem(const FreeBusyItem::Ptr &freebusy);
@@ -53,6 +66,18 @@ public:
 
     [[nodiscard]] bool containsAttendee(const KCalendarCore::Attendee &attendee);
 
+    /**
+     * Returns the busy periods of the attendee in @p row, sorted by start
+     * time. This is the data of the child rows of @p row.
+     */
+    [[nodiscard]] KCalendarCore::FreeBusyPeriod::List busyPeriods(int row) const;
+
+    /**
+     * Returns the rows of the attendees whose email matches @p email,
+     * ignoring case and surrounding white space, in ascending order.
+     */
+    [[nodiscard]] QList<int> rowsForEmail(const QString &email) const;
+
     /**
      * Queues a reload of free/busy data.
      * All current attendees will have their free/busy data
@@ -70,7 +95,36 @@ public:
      */
     void reload();
 
+    /**
+     * Sets how many free/busy retrievals may run at the same time.
+     * Further downloads wait in a queue until a running one finishes.
+     * The default is 4.
+     */
+    void setMaxConcurrentDownloads(int count);
+    [[nodiscard]] int maxConcurrentDownloads() const;
+
+    /**
+     * Lets a queued download of @p freebusy start before the downloads
+     * that were not prioritized, e.g. because its attendee is visible in
+     * a view. Prioritized downloads start in the order they were
+     * prioritized. Attendees added with addItems() are prioritized.
+     */
+    void prioritizeDownload(const FreeBusyItem::Ptr &freebusy);
+
+    /**
+     * Sets whether new attendees show their last known free/busy data,
+     * kept in a cache file shared by the application, until their own
+     * retrieval finishes. Retrieved data is stored in the cache. Only the
+     * times and types of busy periods are kept. Off by default.
+     */
+    void setFreeBusyCacheEnabled(bool enabled);
+    [[nodiscard]] bool isFreeBusyCacheEnabled() const;
+
 public Q_SLOTS:
+    /**
+     * Sets @p fb as the free/busy data of every attendee whose email
+     * matches @p email, ignoring case and surrounding white space.
+     */
     void slotInsertFreeBusy(const KCalendarCore::FreeBusy::Ptr &fb, const QString &email);
 
 protected:
@@ -80,9 +134,11 @@ private:
     // Only download FB if the auto-download option is set in config
     CALENDARSUPPORT_NO_EXPORT void autoReload();
 
+    CALENDARSUPPORT_NO_EXPORT void insertItems(const QList<FreeBusyItem::Ptr> &items, bool prioritized);
     CALENDARSUPPORT_NO_EXPORT void setFreeBusyPeriods(const QModelIndex &parent, const KCalendarCore::FreeBusyPeriod::List &list);
-    CALENDARSUPPORT_NO_EXPORT void updateFreeBusyData(const FreeBusyItem::Ptr &);
+    CALENDARSUPPORT_NO_EXPORT void updateFreeBusyData(const FreeBusyItem::Ptr &, bool prioritized = false);
 
+    friend class FreeBusyItemModelPrivate;
     std::unique_ptr<FreeBusyItemModelPrivate> const d;
 };
 }
@@ -0,0 +1,119 @@
+/*
+  SPDX-FileCopyrightText: 2010 Casey Link <unnamedrambler@gmail.com>
+  SPDX-FileCopyrightText: 2009-2010 Klaralvdalens Datakonsult AB, a KDAB Group company <info@kdab.net>
+
+  SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "calendarsupport_private_export.h"
+
+#include "freebusycache.h"
+#include "freebusyitem.h"
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QPointer>
+#include <QTimer>
+
+#include <deque>
+#include <functional>
+
+class ItemPrivateData;
+
+namespace CalendarSupport
+{
+class FreeBusyItemModel;
+
+// Internal to the library; exported for the tests, which drive the download
+// queue through it.
+class CALENDARSUPPORT_TESTS_EXPORT FreeBusyItemModelPrivate
+{
+public:
+    ~FreeBusyItemModelPrivate();
+
+    static FreeBusyItemModelPrivate *get(FreeBusyItemModel *model);
+
+    static QString normalizedEmail(const QString &email)
+    {
+        return email.trimmed().toLower();
+    }
+
+    void indexRow(int row);
+    // Called before the row is taken out of mFreeBusyItems
+    void unindexRow(int row);
+    [[nodiscard]] QList<int> rowsForEmail(const QString &email) const;
+    [[nodiscard]] int rowOfAttendee(const KCalendarCore::Attendee &attendee) const;
+
+    struct PendingUpdate {
+        qint64 deadline;
+        int id;
+        FreeBusyItem::Ptr item;
+        bool prioritized;
+    };
+
+    void cancelUpdate(const FreeBusyItem::Ptr &item);
+    [[nodiscard]] bool hasPendingUpdate(const FreeBusyItem::Ptr &item) const;
+    void startDueDownloads();
+
+    struct QueuedDownload {
+        FreeBusyItem::Ptr item;
+        bool forceDownload = false;
+        bool prioritized = false;
+        // Matches the entry in mDownloadOrder or mPriorityOrder that is
+        // still valid; other entries for the same email are stale
+        quint64 ticket = 0;
+    };
+    using OrderEntry = std::pair<QString, quint64>;
+
+    void queueDownload(const FreeBusyItem::Ptr &item, bool forceDownload, bool prioritized);
+    void startQueuedDownloads();
+    void finishDownload(const QString &email);
+    void expireDownloads();
+    [[nodiscard]] bool takeNextDownload(QString &email, QueuedDownload &download);
+    void setDownloading(const QString &email, bool downloading);
+
+    QTimer mReloadTimer;
+    // Downloads of all attendees waiting for their update, oldest first. As
+    // every update waits for the same delay, that is also deadline order.
+    std::deque<PendingUpdate> mPendingUpdates;
+    // The id of the latest update of each item in mPendingUpdates; entries
+    // with an older id were superseded by a later update
+    QHash<const FreeBusyItem *, int> mUpdateIds;
+    QTimer mUpdateTimer;
+    QElapsedTimer mUpdateClock;
+    int mNextUpdateId = 0;
+    // Downloads waiting for a free slot, by normalized email. Prioritized
+    // ones start first, in the order they were prioritized, then the others
+    // in the order they were queued.
+    QHash<QString, QueuedDownload> mQueuedDownloads;
+    std::deque<OrderEntry> mPriorityOrder;
+    std::deque<OrderEntry> mDownloadOrder;
+    quint64 mNextTicket = 0;
+    // Start times of the running downloads, by normalized email. A download
+    // runs until its reply arrives, or until it times out.
+    QHash<QString, qint64> mRunningDownloads;
+    QTimer mDownloadTimeoutTimer;
+    qint64 mDownloadTimeout = 30 * 1000;
+    // Set while startQueuedDownloads() starts retrievals
+    bool mStartingDownloads = false;
+    // The download being started. Akonadi answers some retrievals before
+    // they return, e.g. from locally cached data; such a reply is the only
+    // one, so the download ends as soon as its start returns.
+    QString mStartingEmail;
+    bool mStartingAnswered = false;
+    // Starts the retrieval of free/busy data, replaced by the tests
+    std::function<bool(const FreeBusyItem::Ptr &, bool)> mRetrieve = [](const FreeBusyItem::Ptr &item, bool forceDownload) {
+        return item->retrieveFreeBusy(forceDownload);
+    };
+    int mMaxDownloads = 4;
+    // Not owned
+    QPointer<FreeBusyCache> mCache;
+    bool mForceDownload = false;
+    QList<FreeBusyItem::Ptr> mFreeBusyItems;
+    // Rows of mFreeBusyItems by normalized attendee email, in ascending order
+    QHash<QString, QList<int>> mRowsByEmail;
+    ItemPrivateData *mRootData = nullptr;
+};
+}
@@ -0,0 +1,248 @@
+/*
+  SPDX-FileCopyrightText: 2026 KDE PIM Authors
+
+  SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "freeperiodfinder.h"
+#include "calendarsupport_debug.h"
+#include "freebusyitemmodel.h"
+
+#include <QPointer>
+#include <QTimeZone>
+
+#include <algorithm>
+#include <queue>
+#include <vector>
+
+using namespace CalendarSupport;
+
+class CalendarSupport::FreePeriodFinderPrivate
+{
+public:
+    QPointer<FreeBusyItemModel> mModel;
+    QDateTime mSearchStart;
+    QDateTime mSearchEnd;
+    QTime mWorkStart;
+    QTime mWorkEnd;
+    int mWorkWeekMask = 0x7f;
+};
+
+// Working hours that end when they start leave no time at all
+static bool hasWorkingTime(QTime start, QTime end)
+{
+    if (start.isValid() && end.isValid() && start == end) {
+        qCWarning(CALENDARSUPPORT_LOG) << "Working hours start and end at the same time, no free periods are found:" << start;
+        return false;
+    }
+    return true;
+}
+
+namespace
+{
+// The next period of one attendee that still has to be merged
+struct Head {
+    qint64 start;
+    qint64 end;
+    int list;
+    qsizetype pos;
+
+    bool operator>(const Head &other) const
+    {
+        return start > other.start;
+    }
+};
+
+// Collects the free periods of the merged timeline, cut to the working hours
+class FreePeriodCollector
+{
+public:
+    FreePeriodCollector(const QTimeZone &timeZone, int workWeekMask, QTime workStart, QTime workEnd)
+        : mTimeZone(timeZone)
+        , mWorkWeekMask(workWeekMask & 0x7f)
+        , mWorkStart(workStart)
+        , mWorkEnd(workEnd)
+        , mHasWorkHours(workStart.isValid() && workEnd.isValid())
+        , mWorkWraps(mHasWorkHours && workEnd < workStart)
+    {
+    }
+
+    void addGap(qint64 start, qint64 end)
+    {
+        if (start >= end) {
+            return;
+        }
+        if (mWorkWeekMask == 0x7f && !mHasWorkHours) {
+            append(start, end);
+            return;
+        }
+
+        // A night shift belongs to the day it starts on, so the one of the
+        // day before may still cover the start of the gap
+        QDate date = QDateTime::fromMSecsSinceEpoch(start, mTimeZone).date();
+        if (mWorkWraps) {
+            date = date.addDays(-1);
+        }
+        for (;; date = date.addDays(1)) {
+            const qint64 dayStart = QDateTime(date, QTime(0, 0), mTimeZone).toMSecsSinceEpoch();
+            if (dayStart >= end) {
+                break;
+            }
+            if (!(mWorkWeekMask & (1 << (date.dayOfWeek() - 1)))) {
+                continue;
+            }
+            qint64 from = dayStart;
+            qint64 to = QDateTime(date.addDays(1), QTime(0, 0), mTimeZone).toMSecsSinceEpoch();
+            if (mHasWorkHours) {
+                from = QDateTime(date, mWorkStart, mTimeZone).toMSecsSinceEpoch();
+                to = QDateTime(mWorkWraps ? date.addDays(1) : date, mWorkEnd, mTimeZone).toMSecsSinceEpoch();
+            }
+            from = std::max(from, start);
+            to = std::min(to, end);
+            if (from < to) {
+                append(from, to);
+            }
+        }
+    }
+
+    [[nodiscard]] KCalendarCore::Period::List periods() const
+    {
+        KCalendarCore::Period::List periods;
+        periods.reserve(mRanges.size());
+        for (const auto &[start, end] : mRanges) {
+            periods.append(KCalendarCore::Period(QDateTime::fromMSecsSinceEpoch(start, mTimeZone), QDateTime::fromMSecsSinceEpoch(end, mTimeZone)));
+        }
+        return periods;
+    }
+
+private:
+    void append(qint64 start, qint64 end)
+    {
+        // Whole free days follow each other without a gap
+        if (!mRanges.empty() && mRanges.back().second == start) {
+            mRanges.back().second = end;
+        } else {
+            mRanges.emplace_back(start, end);
+        }
+    }
+
+    const QTimeZone mTimeZone;
+    const int mWorkWeekMask;
+    const QTime mWorkStart;
+    const QTime mWorkEnd;
+    const bool mHasWorkHours;
+    // The working hours end on the next day
+    const bool mWorkWraps;
+    std::vector<std::pair<qint64, qint64>> mRanges;
+};
+}
+
+FreePeriodFinder::FreePeriodFinder(QObject *parent)
+    : QObject(parent)
+    , d(new FreePeriodFinderPrivate)
+{
+}
+
+FreePeriodFinder::~FreePeriodFinder() = default;
+
+void FreePeriodFinder::setModel(FreeBusyItemModel *model)
+{
+    d->mModel = model;
+}
+
+FreeBusyItemModel *FreePeriodFinder::model() const
+{
+    return d->mModel;
+}
+
+void FreePeriodFinder::setSearchWindow(const QDateTime &start, const QDateTime &end)
+{
+    d->mSearchStart = start;
+    d->mSearchEnd = end;
+}
+
+QDateTime FreePeriodFinder::searchStart() const
+{
+    return d->mSearchStart;
+}
+
+QDateTime FreePeriodFinder::searchEnd() const
+{
+    return d->mSearchEnd;
+}
+
+void FreePeriodFinder::setWorkingHours(int workWeekMask, QTime start, QTime end)
+{
+    d->mWorkWeekMask = workWeekMask;
+    d->mWorkStart = start;
+    d->mWorkEnd = end;
+}
+
+KCalendarCore::Period::List FreePeriodFinder::freePeriods(const QList<KCalendarCore::FreeBusyPeriod::List> &busyPeriods,
+                                                          const QDateTime &start,
+                                                          const QDateTime &end,
+                                                          int workWeekMask,
+                                                          QTime workStart,
+                                                          QTime workEnd)
+{
+    if (!start.isValid() || !end.isValid() || start >= end) {
+        return {};
+    }
+
+    if (!hasWorkingTime(workStart, workEnd)) {
+        return {};
+    }
+    const qint64 windowStart = start.toMSecsSinceEpoch();
+    const qint64 windowEnd = end.toMSecsSinceEpoch();
+    FreePeriodCollector collector(start.timeZone(), workWeekMask, workStart, workEnd);
+
+    std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heads;
+    // Queues the first period of the list at or after pos that blocks time
+    const auto pushNext = [&busyPeriods, &heads](int list, qsizetype pos) {
+        const KCalendarCore::FreeBusyPeriod::List &periods = busyPeriods.at(list);
+        for (; pos < periods.size(); ++pos) {
+            const KCalendarCore::FreeBusyPeriod &period = periods.at(pos);
+            if (period.type() != KCalendarCore::FreeBusyPeriod::Free) {
+                heads.push({period.start().toMSecsSinceEpoch(), period.end().toMSecsSinceEpoch(), list, pos});
+                return;
+            }
+        }
+    };
+    for (int list = 0; list < busyPeriods.size(); ++list) {
+        pushNext(list, 0);
+    }
+
+    // Everything before busyUntil is covered by a busy period already seen
+    qint64 busyUntil = windowStart;
+    while (!heads.empty()) {
+        const Head head = heads.top();
+        heads.pop();
+        if (head.start >= windowEnd) {
+            // All the other periods start even later
+            break;
+        }
+        if (head.start > busyUntil) {
+            collector.addGap(busyUntil, head.start);
+        }
+        busyUntil = std::max(busyUntil, head.end);
+        pushNext(head.list, head.pos + 1);
+    }
+    collector.addGap(busyUntil, windowEnd);
+
+    return collector.periods();
+}
+
+void FreePeriodFinder::search()
+{
+    QList<KCalendarCore::FreeBusyPeriod::List> busyPeriods;
+    if (d->mModel) {
+        const int count = d->mModel->rowCount();
+        busyPeriods.reserve(count);
+        for (int row = 0; row < count; ++row) {
+            busyPeriods.append(d->mModel->busyPeriods(row));
+        }
+    }
+    Q_EMIT freePeriodsFound(freePeriods(busyPeriods, d->mSearchStart, d->mSearchEnd, d->mWorkWeekMask, d->mWorkStart, d->mWorkEnd));
+}
+
+#include "moc_freeperiodfinder.cpp"
@@ -0,0 +1,96 @@
+/*
+  SPDX-FileCopyrightText: 2026 KDE PIM Authors
+
+  SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "calendarsupport_export.h"
+
+#include <KCalendarCore/FreeBusyPeriod>
+#include <KCalendarCore/Period>
+
+#include <QObject>
+
+#include <memory>
+
+namespace CalendarSupport
+{
+class FreeBusyItemModel;
+class FreePeriodFinderPrivate;
+
+/**
+ * The FreePeriodFinder computes the periods in which all attendees of a
+ * FreeBusyItemModel are free.
+ *
+ * The busy periods of all attendees are merged into one timeline, and the
+ * gaps of that timeline within the search window and the working hours are
+ * reported by freePeriodsFound(), which can be connected to
+ * FreePeriodModel::slotNewFreePeriods().
+ */
+class CALENDARSUPPORT_EXPORT FreePeriodFinder : public QObject
+{
+    Q_OBJECT
+public:
+    explicit FreePeriodFinder(QObject *parent = nullptr);
+    ~FreePeriodFinder() override;
+
+    /**
+     * Sets the model whose attendees have to be free.
+     * The finder does not take ownership of @p model.
+     */
+    void setModel(FreeBusyItemModel *model);
+    [[nodiscard]] FreeBusyItemModel *model() const;
+
+    /**
+     * Sets the time to search free periods in, from @p start up to @p end.
+     * Working hours are taken in the time zone of @p start.
+     */
+    void setSearchWindow(const QDateTime &start, const QDateTime &end);
+    [[nodiscard]] QDateTime searchStart() const;
+    [[nodiscard]] QDateTime searchEnd() const;
+
+    /**
+     * Restricts free periods to the days in @p workWeekMask, where bit 0
+     * stands for Monday as in KCalPrefs, and to the time from @p start up to
+     * @p end on each of those days. Invalid times allow the whole day.
+     * If @p end is before @p start, the working hours span midnight: they
+     * start on each of the days and end on the next day. If @p start
+     * equals @p end, there is no working time and search() finds no free
+     * periods.
+     */
+    void setWorkingHours(int workWeekMask, QTime start = QTime(), QTime end = QTime());
+
+    /**
+     * Returns the free periods in [@p start, @p end) left by @p busyPeriods,
+     * one list per attendee, each sorted by start time. Free periods only
+     * cover the days in @p workWeekMask, and the time from @p workStart up
+     * to @p workEnd on each of them, if both are valid. As with
+     * setWorkingHours(), working hours may span midnight, and equal times
+     * leave no free periods.
+     *
+     * The lists are merged with a heap, so the cost is O(P log N) for P
+     * periods of N attendees.
+     */
+    [[nodiscard]] static KCalendarCore::Period::List freePeriods(const QList<KCalendarCore::FreeBusyPeriod::List> &busyPeriods,
+                                                                 const QDateTime &start,
+                                                                 const QDateTime &end,
+                                                                 int workWeekMask = 0x7f,
+                                                                 QTime workStart = QTime(),
+                                                                 QTime workEnd = QTime());
+
+public Q_SLOTS:
+    /**
+     * Computes the free periods of the current attendees of the model and
+     * emits freePeriodsFound() with them.
+     */
+    void search();
+
+Q_SIGNALS:
+    void freePeriodsFound(const KCalendarCore::Period::List &freePeriods);
+
+private:
+    std::unique_ptr<FreePeriodFinderPrivate> const d;
+};
+}
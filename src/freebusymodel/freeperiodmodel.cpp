@@ -14,10 +14,72 @@
 #include <QLocale>
 #include <QTimeZone>
 
+#include <algorithm>
+#include <vector>
+
 using namespace CalendarSupport;
 
+namespace
+{
+// Finds the next start of a day in the time zone of a date time, in
+// milliseconds since the epoch. Only UTC and fixed offsets need no calendar
+// arithmetic at all: any other zone may change its offset between two days,
+// also without daylight saving time, e.g. when its standard offset changed.
+class DayBoundaries
+{
+public:
+    explicit DayBoundaries(const QDateTime &dateTime)
+        : mTimeZone(dateTime.timeZone())
+        , mFixedOffset(mTimeZone.isUtcOrFixedOffset())
+        , mOffsetMSecs(qint64(dateTime.offsetFromUtc()) * 1000)
+    {
+    }
+
+    [[nodiscard]] qint64 nextMidnight(qint64 msecs) const
+    {
+        static const qint64 dayMSecs = 24 * 60 * 60 * 1000;
+        if (mFixedOffset) {
+            const qint64 local = msecs + mOffsetMSecs;
+            const qint64 day = local >= 0 ? local / dayMSecs : (local - dayMSecs + 1) / dayMSecs;
+            return (day + 1) * dayMSecs - mOffsetMSecs;
+        }
+        // A day whose midnight was skipped starts at its first valid time
+        const QDate date = QDateTime::fromMSecsSinceEpoch(msecs, mTimeZone).date();
+        return date.addDays(1).startOfDay(mTimeZone).toMSecsSinceEpoch();
+    }
+
+private:
+    const QTimeZone mTimeZone;
+    const bool mFixedOffset;
+    const qint64 mOffsetMSecs;
+};
+}
+
+class CalendarSupport::FreePeriodModelPrivate
+{
+public:
+    struct DisplayStrings {
+        QString day;
+        QString date;
+        QString toolTip;
+    };
+
+    // The formatted strings of each period in mPeriodList
+    QList<DisplayStrings> mDisplayStrings;
+    // Set by refreshDisplayStrings(); the strings are formatted again when
+    // they are asked for next
+    bool mDisplayStringsStale = false;
+};
+
+// Whether two periods of the same time are also displayed the same
+static bool sameRepresentation(const KCalendarCore::Period &a, const KCalendarCore::Period &b)
+{
+    return a.hasDuration() == b.hasDuration() && a.start().timeZone() == b.start().timeZone() && a.end().timeZone() == b.end().timeZone();
+}
+
 FreePeriodModel::FreePeriodModel(QObject *parent)
     : QAbstractTableModel(parent)
+    , d(new FreePeriodModelPrivate)
 {
 }
 
@@ -29,12 +91,16 @@ QVariant FreePeriodModel::data(const QModelIndex &index, int role) const
         return {};
     }
 
+    if (d->mDisplayStringsStale && (role == Qt::DisplayRole || role == Qt::ToolTipRole)) {
+        formatStaleDisplayStrings();
+    }
+
     if (index.column() == 0) { // day
         switch (role) {
         case Qt::DisplayRole:
-            return day(index.row());
+            return d->mDisplayStrings.at(index.row()).day;
         case Qt::ToolTipRole:
-            return tooltipify(index.row());
+            return d->mDisplayStrings.at(index.row()).toolTip;
         case FreePeriodModel::PeriodRole:
             return QVariant::fromValue(mPeriodList.at(index.row()));
         case Qt::TextAlignmentRole:
@@ -45,9 +111,9 @@ QVariant FreePeriodModel::data(const QModelIndex &index, int role) const
     } else { // everything else
         switch (role) {
         case Qt::DisplayRole:
-            return date(index.row());
+            return d->mDisplayStrings.at(index.row()).date;
         case Qt::ToolTipRole:
-            return tooltipify(index.row());
+            return d->mDisplayStrings.at(index.row()).toolTip;
         case FreePeriodModel::PeriodRole:
             return QVariant::fromValue(mPeriodList.at(index.row()));
         case Qt::TextAlignmentRole:
@@ -77,43 +143,155 @@ QVariant FreePeriodModel::headerData(int section, Qt::Orientation orientation, i
     return QAbstractItemModel::headerData(section, orientation, role);
 }
 
+void FreePeriodModel::refreshDisplayStrings()
+{
+    d->mDisplayStringsStale = true;
+    if (!mPeriodList.isEmpty()) {
+        Q_EMIT dataChanged(index(0, 0), index(rowCount() - 1, columnCount() - 1), {Qt::DisplayRole, Qt::ToolTipRole});
+    }
+}
+
 void FreePeriodModel::slotNewFreePeriods(const KCalendarCore::Period::List &freePeriods)
 {
-    beginResetModel();
-    mPeriodList.clear();
-    mPeriodList = splitPeriodsByDay(freePeriods);
-    std::sort(mPeriodList.begin(), mPeriodList.end());
-    endResetModel();
+    // Already sorted by start and end
+    const KCalendarCore::Period::List newList = splitPeriodsByDay(freePeriods);
+
+    // Both lists are sorted, so walking them side by side finds the periods
+    // that went away and the ones that are new. A run of removed periods
+    // followed by a run of new ones at the same place is reported as changed
+    // rows, the rest as removed or inserted rows, which keeps the selection
+    // and scroll position of views on the untouched rows.
+    const auto startsBefore = [](const KCalendarCore::Period &a, const KCalendarCore::Period &b) {
+        return a.start() < b.start() || (a.start() == b.start() && a.end() < b.end());
+    };
+    const KCalendarCore::Period::List oldList = mPeriodList;
+    int row = 0;
+    qsizetype oldPos = 0;
+    qsizetype newPos = 0;
+    int removed = 0;
+    int added = 0;
+    const auto flush = [&]() {
+        const int changed = std::min(removed, added);
+        const qsizetype firstAdded = newPos - added;
+        if (changed > 0) {
+            for (int i = 0; i < changed; ++i) {
+                mPeriodList[row + i] = newList.at(firstAdded + i);
+                formatDisplayStrings(row + i);
+            }
+            Q_EMIT dataChanged(index(row, 0), index(row + changed - 1, columnCount() - 1));
+        }
+        if (removed > changed) {
+            beginRemoveRows(QModelIndex(), row + changed, row + removed - 1);
+            mPeriodList.remove(row + changed, removed - changed);
+            d->mDisplayStrings.remove(row + changed, removed - changed);
+            endRemoveRows();
+        } else if (added > changed) {
+            beginInsertRows(QModelIndex(), row + changed, row + added - 1);
+            for (qsizetype i = firstAdded + changed; i < newPos; ++i) {
+                const int newRow = row + (i - firstAdded);
+                mPeriodList.insert(newRow, newList.at(i));
+                d->mDisplayStrings.insert(newRow, FreePeriodModelPrivate::DisplayStrings());
+                formatDisplayStrings(newRow);
+            }
+            endInsertRows();
+        }
+        row += added;
+        removed = 0;
+        added = 0;
+    };
+
+    while (oldPos < oldList.size() || newPos < newList.size()) {
+        if (oldPos < oldList.size() && newPos < newList.size() && oldList.at(oldPos).start() == newList.at(newPos).start()
+            && oldList.at(oldPos).end() == newList.at(newPos).end()) {
+            flush();
+            // The same time may come in another time zone or as a duration,
+            // which shows differently
+            if (!sameRepresentation(oldList.at(oldPos), newList.at(newPos))) {
+                mPeriodList[row] = newList.at(newPos);
+                formatDisplayStrings(row);
+                Q_EMIT dataChanged(index(row, 0), index(row, columnCount() - 1));
+            }
+            ++oldPos;
+            ++newPos;
+            ++row;
+        } else if (newPos == newList.size() || (oldPos < oldList.size() && startsBefore(oldList.at(oldPos), newList.at(newPos)))) {
+            ++removed;
+            ++oldPos;
+        } else {
+            ++added;
+            ++newPos;
+        }
+    }
+    flush();
+}
+
+void FreePeriodModel::formatDisplayStrings(int index) const
+{
+    d->mDisplayStrings[index] = {day(index), date(index), tooltipify(index)};
+}
+
+void FreePeriodModel::formatStaleDisplayStrings() const
+{
+    d->mDisplayStringsStale = false;
+    for (int i = 0; i < d->mDisplayStrings.size(); ++i) {
+        formatDisplayStrings(i);
+    }
 }
 
 KCalendarCore::Period::List FreePeriodModel::splitPeriodsByDay(const KCalendarCore::Period::List &freePeriods)
 {
-    KCalendarCore::Period::List splitList;
-    for (const KCalendarCore::Period &period : freePeriods) {
+    const qint64 validPeriodMSecs = 300 * 1000; // 5 minutes
+
+    // Split on milliseconds since the epoch; only the day boundaries need
+    // the time zone. The pieces are sorted once, as plain integers.
+    struct Piece {
+        qint64 start;
+        qint64 end;
+        qsizetype source;
+        bool whole;
+    };
+    std::vector<Piece> pieces;
+    pieces.reserve(freePeriods.size());
+    for (qsizetype i = 0; i < freePeriods.size(); ++i) {
+        const KCalendarCore::Period &period = freePeriods.at(i);
+        qint64 start = period.start().toMSecsSinceEpoch();
+        const qint64 end = period.end().toMSecsSinceEpoch();
         if (period.start().date() == period.end().date()) {
-            splitList << period; // period occurs on the same day
+            pieces.push_back({start, end, i, true}); // period occurs on the same day
             continue;
         }
 
-        const int validPeriodSecs = 300; // 5 minutes
-        KCalendarCore::Period tmpPeriod = period;
-        while (tmpPeriod.start().date() != tmpPeriod.end().date()) {
-            const QDateTime midnight(tmpPeriod.start().date(), QTime(23, 59, 59, 999), tmpPeriod.start().timeZone());
-            KCalendarCore::Period firstPeriod(tmpPeriod.start(), midnight);
-            KCalendarCore::Period secondPeriod(midnight.addMSecs(1), tmpPeriod.end());
-            if (firstPeriod.duration().asSeconds() >= validPeriodSecs) {
-                splitList << firstPeriod;
+        const DayBoundaries boundaries(period.start());
+        for (qint64 midnight = boundaries.nextMidnight(start); midnight <= end; midnight = boundaries.nextMidnight(start)) {
+            // The day ends at 23:59:59.999, the next one starts at midnight
+            if (midnight - 1 - start >= validPeriodMSecs) {
+                pieces.push_back({start, midnight - 1, i, false});
             }
-            tmpPeriod = secondPeriod;
+            start = midnight;
         }
-        if (tmpPeriod.duration().asSeconds() >= validPeriodSecs) {
-            splitList << tmpPeriod;
+        if (end - start >= validPeriodMSecs) {
+            pieces.push_back({start, end, i, false});
         }
     }
 
-    // Perform some jiggery pokery to remove duplicates
-    std::sort(splitList.begin(), splitList.end());
-    splitList.erase(std::unique(splitList.begin(), splitList.end()), splitList.end());
+    std::sort(pieces.begin(), pieces.end(), [](const Piece &a, const Piece &b) {
+        return a.start < b.start || (a.start == b.start && a.end < b.end);
+    });
+
+    KCalendarCore::Period::List splitList;
+    splitList.reserve(pieces.size());
+    for (std::size_t i = 0; i < pieces.size(); ++i) {
+        const Piece &piece = pieces[i];
+        if (i > 0 && piece.start == pieces[i - 1].start && piece.end == pieces[i - 1].end) {
+            continue; // remove duplicates
+        }
+        if (piece.whole) {
+            splitList << freePeriods.at(piece.source);
+        } else {
+            const QTimeZone timeZone = freePeriods.at(piece.source).start().timeZone();
+            splitList << KCalendarCore::Period(QDateTime::fromMSecsSinceEpoch(piece.start, timeZone), QDateTime::fromMSecsSinceEpoch(piece.end, timeZone));
+        }
+    }
     return splitList;
 }
 
@@ -13,8 +13,12 @@
 
 #include <QAbstractTableModel>
 
+#include <memory>
+
 namespace CalendarSupport
 {
+class FreePeriodModelPrivate;
+
 /// Model representing the free-busy periods
 class CALENDARSUPPORT_EXPORT FreePeriodModel : public QAbstractTableModel
 {
@@ -32,6 +36,15 @@ public:
 public Q_SLOTS:
     void slotNewFreePeriods(const KCalendarCore::Period::List &freePeriods);
 
+    /**
+     * Formats the displayed dates and tool tips of all periods again.
+     * They are formatted once per period, so call this when the locale,
+     * the translation or the time zone changed, e.g. from the changeEvent()
+     * of the view showing the model on QEvent::LanguageChange or
+     * QEvent::LocaleChange.
+     */
+    void refreshDisplayStrings();
+
 private:
     /** Splits period blocks in the provided list, so that each period occurs on one day */
     KCalendarCore::Period::List splitPeriodsByDay(const KCalendarCore::Period::List &freePeriods);
@@ -41,7 +54,13 @@ private:
     [[nodiscard]] CALENDARSUPPORT_NO_EXPORT QString stringify(int index) const;
     [[nodiscard]] CALENDARSUPPORT_NO_EXPORT QString tooltipify(int index) const;
 
+    /** Formats the strings of the period at @p index */
+    CALENDARSUPPORT_NO_EXPORT void formatDisplayStrings(int index) const;
+    /** Formats all strings again after refreshDisplayStrings() */
+    CALENDARSUPPORT_NO_EXPORT void formatStaleDisplayStrings() const;
+
     KCalendarCore::Period::List mPeriodList;
+    std::unique_ptr<FreePeriodModelPrivate> const d;
     friend class FreePeriodModelTest;
 };
 }
@@ -102,6 +102,21 @@ public:
         return !(other->start() >= end() || other->end() <= start());
     }
 
+    [[nodiscard]] bool hasRange() const override
+    {
+        return true;
+    }
+
+    [[nodiscard]] qint64 rangeStart() const override
+    {
+        return mStart.toMSecsSinceEpoch();
+    }
+
+    [[nodiscard]] qint64 rangeEnd() const override
+    {
+        return mEnd.toMSecsSinceEpoch();
+    }
+
 private:
     KCalendarCore::Event::Ptr mEvent;
     QDateTime mStart, mEnd;
@@ -867,11 +882,7 @@ void CalPrintPluginBase::drawAgendaDayBox(QPainter &p,
         }
     }
 
-    QListIterator<CellItem *> it1(cells);
-    while (it1.hasNext()) {
-        CellItem *placeItem = it1.next();
-        CellItem::placeItem(cells, placeItem);
-    }
+    CellItem::placeItems(cells);
 
     QListIterator<CellItem *> it2(cells);
     while (it2.hasNext()) {